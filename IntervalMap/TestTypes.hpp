@@ -4,6 +4,7 @@
 #define INTERVAL_MAP_TEST_TYPES_HPP
 
 // Some very constrained test types to use with the interval_map.
+#include <cstddef>
 #include <ostream>
 
 class TestKey
@@ -26,6 +27,38 @@ public:
     int m_value;
 };
 
+// Key counting its constructions, comparable with plain ints
+class CountedKey
+{
+public:
+    CountedKey(int value) : m_value(value) { s_constructed++; }
+    CountedKey(const CountedKey& cp) : m_value(cp.m_value) { s_constructed++; }
+
+    CountedKey& operator=(const CountedKey& rhs)
+    {
+        m_value = rhs.m_value;
+        return *this;
+    }
+
+    bool operator<(const CountedKey& rhs) const
+    {
+        return m_value < rhs.m_value;
+    }
+
+    friend bool operator<(const CountedKey& lhs, int rhs)
+    {
+        return lhs.m_value < rhs;
+    }
+
+    friend bool operator<(int lhs, const CountedKey& rhs)
+    {
+        return lhs < rhs.m_value;
+    }
+
+    int m_value;
+    static inline size_t s_constructed = 0;
+};
+
 class TestValue
 {
 public:
@@ -0,0 +1,331 @@
+/* Copyright (C) 2024, Valkai-Nmeth Bla-rs */
+
+#ifndef INTERVAL_MAP_BUFFERED_INTERVAL_MAP_HPP
+#define INTERVAL_MAP_BUFFERED_INTERVAL_MAP_HPP
+
+#include "interval_map.hpp"
+#include <algorithm>
+#include <queue>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// interval_map which only logs assign calls and merges them into the underlying
+// Map in one linear pass on the next look-up or an explicit flush().
+// The result is the same as applying the assign calls one by one, in order.
+// Large logs can be flattened on several threads, see replay().
+// The underlying interval_map is only reachable through members which merge the
+// pending assigns first, merged() gives it to what takes an interval_map.
+template<typename K, typename V, typename Map = std::map<K, V>>
+class buffered_interval_map : protected interval_map<K, V, Map>
+{
+public:
+    using change = typename interval_map<K, V, Map>::change;
+
+    struct entry
+    {
+        entry(K const& keyBegin, K const& keyEnd, V const& val)
+            : keyBegin(keyBegin)
+            , keyEnd(keyEnd)
+            , val(val)
+        {}
+
+        K keyBegin;
+        K keyEnd;
+        V val;
+    };
+
+    buffered_interval_map(V const& val)
+        : interval_map<K, V, Map>(val)
+    {}
+
+    // Log assigning value val to interval [keyBegin, keyEnd), O(1)
+    void assign(K const& keyBegin, K const& keyEnd, V const& val)
+    {
+        if (keyBegin < keyEnd)
+        {
+            m_log.emplace_back(keyBegin, keyEnd, val);
+        }
+    }
+
+    // Log resetting [keyBegin, keyEnd) to the initial value, O(1)
+    void reset(K const& keyBegin, K const& keyEnd)
+    {
+        assign(keyBegin, keyEnd, this->m_valBegin);
+    }
+
+    // look-up of the value associated with key, merges pending assigns first
+    V const& operator[](K const& key)
+    {
+        flush();
+        return interval_map<K, V, Map>::operator[](key);
+    }
+
+    // Merge all pending assigns into the underlying map
+    void flush()
+    {
+        if (m_log.empty())
+        {
+            return;
+        }
+
+        this->paint(resolve(m_log.begin(), m_log.end()));
+        m_log.clear();
+    }
+
+    // Merge all pending assigns, resolving chunks of the log on threadCount threads
+    void flush(unsigned threadCount)
+    {
+        if (m_log.empty())
+        {
+            return;
+        }
+
+        this->paint(resolve(m_log.begin(), m_log.end(), threadCount));
+        m_log.clear();
+    }
+
+    // Apply a log of assigns, like an audit log, in order on threadCount threads.
+    // Every thread flattens a contiguous chunk of the log, then the chunks are
+    // composed pairwise (later chunks winning) and merged into the map at once.
+    template<typename It>
+    void replay(It first, It last, unsigned threadCount = std::thread::hardware_concurrency())
+    {
+        flush();
+
+        if (first != last)
+        {
+            this->paint(resolve(first, last, threadCount));
+        }
+    }
+
+    size_t pending() const
+    {
+        return m_log.size();
+    }
+
+    // The underlying interval_map with the pending assigns merged, for cursors,
+    // overlays and the like. Further assigns invalidate what is read through it.
+    interval_map<K, V, Map> const& merged()
+    {
+        flush();
+        return *this;
+    }
+
+    // Paint overrides on top of this map with its pending assigns merged.
+    // A buffered map is passed as overrides through merged().
+    template<typename OverridesMap>
+    void overlay(interval_map<K, V, OverridesMap> const& overrides)
+    {
+        flush();
+        interval_map<K, V, Map>::overlay(overrides);
+    }
+
+    // Replace contents with combine(a[key], b[key]), pending assigns are dropped
+    template<typename VA, typename MapA, typename VB, typename MapB, typename Combine>
+    void combine(interval_map<K, VA, MapA> const& a, interval_map<K, VB, MapB> const& b, Combine combine)
+    {
+        m_log.clear();
+        interval_map<K, V, Map>::combine(a, b, combine);
+    }
+
+    // Replace contents with the pairs (a[key], b[key]), pending assigns are dropped
+    template<typename VA, typename MapA, typename VB, typename MapB>
+    void zip(interval_map<K, VA, MapA> const& a, interval_map<K, VB, MapB> const& b)
+    {
+        m_log.clear();
+        interval_map<K, V, Map>::zip(a, b);
+    }
+
+    // Move the part at and after key into right, both with pending assigns merged
+    void split(K const& key, buffered_interval_map& right)
+    {
+        flush();
+        right.m_log.clear();
+        interval_map<K, V, Map>::split(key, right);
+    }
+
+    // Move all entries of right here, both with pending assigns merged
+    void join(buffered_interval_map& right)
+    {
+        flush();
+        right.flush();
+        interval_map<K, V, Map>::join(right);
+    }
+
+    // Rebuild the underlying map in key order with pending assigns merged
+    void compact()
+    {
+        flush();
+        interval_map<K, V, Map>::compact();
+    }
+
+    // Writes turning this map, pending assigns merged, into target
+    template<typename TargetMap>
+    std::vector<change> diff(interval_map<K, V, TargetMap> const& target)
+    {
+        flush();
+        return interval_map<K, V, Map>::diff(target);
+    }
+
+protected:
+    // Boundaries of what a run of the log paints, pointing into the log
+    using typename interval_map<K, V, Map>::painting;
+
+    // Flatten a run of log entries into what they paint, later entries winning.
+    // Sweeps the sorted boundaries keeping the covering entries in a max-heap on
+    // their position in the log, expired entries are only dropped once on top.
+    template<typename It>
+    static painting resolve(It first, It last)
+    {
+        std::vector<It> byBegin;
+        std::vector<K const*> keys;
+        byBegin.reserve(last - first);
+        keys.reserve(2 * (last - first));
+        for (It it = first; it != last; ++it)
+        {
+            byBegin.push_back(it);
+            keys.push_back(&it->keyBegin);
+            keys.push_back(&it->keyEnd);
+        }
+
+        std::sort(byBegin.begin(), byBegin.end(), [](It lhs, It rhs) { return lhs->keyBegin < rhs->keyBegin; });
+        std::sort(keys.begin(), keys.end(), [](K const* lhs, K const* rhs) { return *lhs < *rhs; });
+
+        auto byPosition = [](It lhs, It rhs) { return lhs < rhs; };
+        std::priority_queue<It, std::vector<It>, decltype(byPosition)> covering(byPosition);
+
+        painting result;
+        auto nextBegin = byBegin.begin();
+        V const* current = nullptr;
+        for (auto keyIt = keys.begin(); keyIt != keys.end(); ++keyIt)
+        {
+            K const& key = **keyIt;
+            if (keys.begin() != keyIt && !(**std::prev(keyIt) < key))
+            {
+                // Same key as the previous one
+                continue;
+            }
+
+            while (byBegin.end() != nextBegin && !(key < (*nextBegin)->keyBegin))
+            {
+                covering.push(*nextBegin++);
+            }
+
+            while (!covering.empty() && !(key < covering.top()->keyEnd))
+            {
+                covering.pop();
+            }
+
+            V const* val = covering.empty() ? nullptr : &covering.top()->val;
+            if (!sameValue(val, current))
+            {
+                result.emplace_back(&key, val);
+                current = val;
+            }
+        }
+
+        return result;
+    }
+
+    template<typename It>
+    static painting resolve(It first, It last, unsigned threadCount)
+    {
+        // Not worth spawning threads for small chunks
+        const size_t minChunkSize = 4096;
+        const size_t size = last - first;
+        const size_t chunkCount = std::max<size_t>(1, std::min<size_t>(threadCount, size / minChunkSize));
+        if (1 == chunkCount)
+        {
+            return resolve(first, last);
+        }
+
+        std::vector<painting> parts(chunkCount);
+        {
+            std::vector<std::thread> threads;
+            for (size_t i = 0; i < chunkCount; i++)
+            {
+                It chunkFirst = first + size * i / chunkCount;
+                It chunkLast = first + size * (i + 1) / chunkCount;
+                threads.emplace_back([&parts, i, chunkFirst, chunkLast]() { parts[i] = resolve(chunkFirst, chunkLast); });
+            }
+
+            for (auto& thread : threads)
+            {
+                thread.join();
+            }
+        }
+
+        while (parts.size() > 1)
+        {
+            std::vector<painting> composed((parts.size() + 1) / 2);
+            std::vector<std::thread> threads;
+            for (size_t i = 0; i + 1 < parts.size(); i += 2)
+            {
+                threads.emplace_back([&parts, &composed, i]() { composed[i / 2] = compose(parts[i], parts[i + 1]); });
+            }
+
+            if (parts.size() % 2)
+            {
+                composed.back() = std::move(parts.back());
+            }
+
+            for (auto& thread : threads)
+            {
+                thread.join();
+            }
+
+            parts = std::move(composed);
+        }
+
+        return std::move(parts.front());
+    }
+
+    // Paint upper on top of lower, walking both once
+    static painting compose(painting const& lower, painting const& upper)
+    {
+        painting result;
+        result.reserve(lower.size() + upper.size());
+
+        auto lowerIt = lower.begin();
+        auto upperIt = upper.begin();
+        V const* lowerVal = nullptr;
+        V const* upperVal = nullptr;
+        V const* current = nullptr;
+        while (lower.end() != lowerIt || upper.end() != upperIt)
+        {
+            K const* key;
+            if (upper.end() == upperIt || (lower.end() != lowerIt && *lowerIt->first < *upperIt->first))
+            {
+                key = lowerIt->first;
+                lowerVal = (lowerIt++)->second;
+            } else if (lower.end() == lowerIt || *upperIt->first < *lowerIt->first) {
+                key = upperIt->first;
+                upperVal = (upperIt++)->second;
+            } else {
+                key = upperIt->first;
+                lowerVal = (lowerIt++)->second;
+                upperVal = (upperIt++)->second;
+            }
+
+            V const* val = upperVal ? upperVal : lowerVal;
+            if (!sameValue(val, current))
+            {
+                result.emplace_back(key, val);
+                current = val;
+            }
+        }
+
+        return result;
+    }
+
+    std::vector<entry> m_log;
+
+private:
+    static bool sameValue(V const* lhs, V const* rhs)
+    {
+        return lhs == rhs || (lhs && rhs && *lhs == *rhs);
+    }
+};
+
+#endif // INTERVAL_MAP_BUFFERED_INTERVAL_MAP_HPP
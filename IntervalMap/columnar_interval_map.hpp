@@ -0,0 +1,80 @@
+/* Copyright (C) 2024, Valkai-Nmeth Bla-rs */
+
+#ifndef INTERVAL_MAP_COLUMNAR_INTERVAL_MAP_HPP
+#define INTERVAL_MAP_COLUMNAR_INTERVAL_MAP_HPP
+
+#include "interval_map.hpp"
+#include <cstddef>
+#include <iterator>
+#include <tuple>
+
+// interval_map of several values per key, given as a tuple (or pair) of columns,
+// sharing one set of boundaries instead of one map per column. A boundary is
+// kept where any column changes. Columns can be assigned one at a time, and
+// operator[] finds all columns of a key with one search.
+template<typename K, typename Columns, typename Map = std::map<K, Columns>>
+class columnar_interval_map : public interval_map<K, Columns, Map>
+{
+public:
+    template<size_t Column>
+    using column_type = std::tuple_element_t<Column, Columns>;
+
+    // constructor associates whole range of K with val
+    columnar_interval_map(Columns const& val)
+        : interval_map<K, Columns, Map>(val)
+    {}
+
+    // Assign value val to interval [keyBegin, keyEnd) of column Column only.
+    // Boundaries no column changes at any more are dropped.
+    template<size_t Column>
+    void assign_column(K const& keyBegin, K const& keyEnd, column_type<Column> const& val)
+    {
+        if (!(keyBegin < keyEnd))
+        {
+            return;
+        }
+
+        auto& map = this->m_map;
+        boundaryAt(keyEnd);
+        for (auto it = boundaryAt(keyBegin); map.end() != it && it->first < keyEnd; ++it)
+        {
+            std::get<Column>(it->second) = val;
+        }
+
+        // Only boundaries from keyBegin to keyEnd can have become redundant
+        for (auto it = map.lower_bound(keyBegin); map.end() != it && !(keyEnd < it->first);)
+        {
+            Columns const& before = map.begin() == it ? this->m_valBegin : std::prev(it)->second;
+            if (it->second == before)
+            {
+                it = map.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    // look-up of the value of column Column associated with key
+    template<size_t Column>
+    column_type<Column> const& column(K const& key) const
+    {
+        return std::get<Column>((*this)[key]);
+    }
+
+private:
+    // Boundary at key holding the columns it already had
+    auto boundaryAt(K const& key)
+    {
+        auto& map = this->m_map;
+        auto it = map.lower_bound(key);
+        if (map.end() == it || key < it->first)
+        {
+            const Columns val = map.begin() == it ? this->m_valBegin : std::prev(it)->second;
+            it = map.emplace_hint(it, key, val);
+        }
+
+        return it;
+    }
+};
+
+#endif // INTERVAL_MAP_COLUMNAR_INTERVAL_MAP_HPP
\ No newline at end of file
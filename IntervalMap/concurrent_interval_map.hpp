@@ -0,0 +1,151 @@
+/* Copyright (C) 2024, Valkai-Nmeth Bla-rs */
+
+#ifndef INTERVAL_MAP_CONCURRENT_INTERVAL_MAP_HPP
+#define INTERVAL_MAP_CONCURRENT_INTERVAL_MAP_HPP
+
+#include "interval_map.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+
+// interval_map for many threads assigning and looking up at once. The key range
+// is cut into shards at fixed split keys, every shard is an interval_map of its
+// own behind a reader/writer lock. Assigns lock only the shards their range
+// touches, in ascending order, so writers of disjoint ranges in different shards
+// never wait for each other and every assign is applied atomically.
+template<typename K, typename V, typename Map = std::map<K, V>>
+class concurrent_interval_map
+{
+public:
+    // constructor associates whole range of K with val, splits must be ascending.
+    // The splits stay where they are, writers crowding into one shard's range
+    // all wait for its lock, so they should cut the keys written into even parts.
+    concurrent_interval_map(V const& val, std::vector<K> splits)
+        : m_valBegin(val)
+        , m_splits(std::move(splits))
+    {
+        for (size_t i = 0; i <= m_splits.size(); i++)
+        {
+            m_shards.push_back(std::make_unique<shard>(val));
+        }
+    }
+
+    concurrent_interval_map(concurrent_interval_map const&) = delete;
+    concurrent_interval_map& operator=(concurrent_interval_map const&) = delete;
+
+    // Assign value val to interval [keyBegin, keyEnd), atomically for all keys
+    void assign(K const& keyBegin, K const& keyEnd, V const& val)
+    {
+        if (!(keyBegin < keyEnd))
+        {
+            return;
+        }
+
+        const size_t first = std::upper_bound(m_splits.begin(), m_splits.end(), keyBegin) - m_splits.begin();
+        const size_t last = std::lower_bound(m_splits.begin(), m_splits.end(), keyEnd) - m_splits.begin();
+        if (first == last)
+        {
+            std::unique_lock<std::shared_mutex> lock(m_shards[first]->mutex);
+            m_shards[first]->assign(keyBegin, keyEnd, val);
+            return;
+        }
+
+        std::vector<std::unique_lock<std::shared_mutex>> locks;
+        locks.reserve(last - first + 1);
+        for (size_t i = first; i <= last; i++)
+        {
+            locks.emplace_back(m_shards[i]->mutex);
+        }
+
+        m_shards[first]->assign(keyBegin, m_splits[first], val);
+        for (size_t i = first + 1; i < last; i++)
+        {
+            m_shards[i]->assign(m_splits[i - 1], m_splits[i], val);
+        }
+
+        m_shards[last]->assign(m_splits[last - 1], keyEnd, val);
+    }
+
+    // look-up of the value associated with key, returned by value since the
+    // entry may change as soon as the shard is unlocked
+    V operator[](K const& key) const
+    {
+        shard const& owner = *m_shards[std::upper_bound(m_splits.begin(), m_splits.end(), key) - m_splits.begin()];
+        std::shared_lock<std::shared_mutex> lock(owner.mutex);
+        return owner[key];
+    }
+
+    // Canonical boundaries of the whole map as (key, value) pairs, taken while
+    // all shards are locked for reading so no assign is seen half applied
+    std::vector<std::pair<K, V>> boundaries() const
+    {
+        std::vector<std::shared_lock<std::shared_mutex>> locks;
+        locks.reserve(m_shards.size());
+        for (auto const& pShard : m_shards)
+        {
+            locks.emplace_back(pShard->mutex);
+        }
+
+        std::vector<std::pair<K, V>> result;
+        V const* current = &m_valBegin;
+        for (size_t i = 0; i < m_shards.size(); i++)
+        {
+            shard const& owner = *m_shards[i];
+            auto it = owner.entries().begin();
+            if (i > 0)
+            {
+                // Carry on from the value the shard has at its first key
+                V const& val = owner[m_splits[i - 1]];
+                if (!(val == *current))
+                {
+                    result.emplace_back(m_splits[i - 1], val);
+                    current = &result.back().second;
+                }
+
+                it = owner.entries().upper_bound(m_splits[i - 1]);
+            }
+
+            for (; owner.entries().end() != it && (m_splits.size() == i || it->first < m_splits[i]); ++it)
+            {
+                if (!(it->second == *current))
+                {
+                    result.emplace_back(it->first, it->second);
+                    current = &result.back().second;
+                }
+            }
+        }
+
+        return result;
+    }
+
+    size_t shard_count() const
+    {
+        return m_shards.size();
+    }
+
+private:
+    // Shards are cache line aligned so their locks do not share lines
+    struct alignas(64) shard : interval_map<K, V, Map>
+    {
+        shard(V const& val)
+            : interval_map<K, V, Map>(val)
+        {}
+
+        Map const& entries() const
+        {
+            return this->m_map;
+        }
+
+        mutable std::shared_mutex mutex;
+    };
+
+    const V m_valBegin;
+    const std::vector<K> m_splits;
+    std::vector<std::unique_ptr<shard>> m_shards;
+};
+
+#endif // INTERVAL_MAP_CONCURRENT_INTERVAL_MAP_HPP
\ No newline at end of file
@@ -0,0 +1,154 @@
+/* Copyright (C) 2024, Valkai-Nmeth Bla-rs */
+
+#ifndef INTERVAL_MAP_CONSTEXPR_INTERVAL_MAP_HPP
+#define INTERVAL_MAP_CONSTEXPR_INTERVAL_MAP_HPP
+
+#include <array>
+#include <cstddef>
+#include <stdexcept>
+
+// interval_map holding at most N boundaries in arrays, usable in constant
+// expressions. Tables known at compile time can be built by a constexpr
+// function or lambda, so there is nothing to initialize at run time and
+// look-ups with constant keys fold to constants.
+// K and V must be literal types with constexpr default constructors.
+template<typename K, typename V, size_t N>
+class constexpr_interval_map
+{
+public:
+    // constructor associates whole range of K with val
+    constexpr constexpr_interval_map(V const& val)
+        : m_valBegin(val)
+    {}
+
+    // Assign value val to interval [keyBegin, keyEnd).
+    // Overwrite previous values in this interval.
+    // Throws std::length_error if the boundaries would not fit, which makes
+    // the expression non-constant when building at compile time.
+    constexpr void assign(K const& keyBegin, K const& keyEnd, V const& val)
+    {
+        if (!(keyBegin < keyEnd))
+        {
+            return;
+        }
+
+        // Entries from keyBegin up to and including keyEnd are replaced by at
+        // most one at keyBegin and one at keyEnd
+        const size_t first = lowerBound(keyBegin);
+        const size_t last = upperBound(keyEnd);
+        V const& valueBefore = 0 == first ? m_valBegin : m_values[first - 1];
+        V const& valueAfter = 0 == last ? m_valBegin : m_values[last - 1];
+        const bool startsValue = !(val == valueBefore);
+        const bool endsValue = !(val == valueAfter);
+
+        const size_t count = (startsValue ? 1 : 0) + (endsValue ? 1 : 0);
+        if (m_size - (last - first) + count > N)
+        {
+            throw std::length_error("constexpr_interval_map is full");
+        }
+
+        // Read before the entries move
+        const V endValue = valueAfter;
+
+        // Move the entries after keyEnd to their place
+        const size_t newLast = first + count;
+        if (newLast < last)
+        {
+            for (size_t i = last; i < m_size; i++)
+            {
+                m_keys[i - (last - newLast)] = m_keys[i];
+                m_values[i - (last - newLast)] = m_values[i];
+            }
+        } else if (newLast > last) {
+            for (size_t i = m_size; i-- > last;)
+            {
+                m_keys[i + (newLast - last)] = m_keys[i];
+                m_values[i + (newLast - last)] = m_values[i];
+            }
+        }
+
+        m_size = m_size - (last - first) + count;
+
+        size_t index = first;
+        if (startsValue)
+        {
+            m_keys[index] = keyBegin;
+            m_values[index++] = val;
+        }
+
+        if (endsValue)
+        {
+            m_keys[index] = keyEnd;
+            m_values[index] = endValue;
+        }
+    }
+
+    // look-up of the value associated with key. Branch free binary search,
+    // halving the range by a conditional move in every step.
+    constexpr V const& operator[](K const& key) const
+    {
+        if (0 == m_size)
+        {
+            return m_valBegin;
+        }
+
+        size_t base = 0;
+        for (size_t count = m_size; count > 1;)
+        {
+            const size_t half = count / 2;
+            base = key < m_keys[base + half] ? base : base + half;
+            count -= half;
+        }
+
+        return key < m_keys[base] ? m_valBegin : m_values[base];
+    }
+
+    constexpr size_t size() const
+    {
+        return m_size;
+    }
+
+private:
+    constexpr size_t lowerBound(K const& key) const
+    {
+        size_t index = 0;
+        for (size_t count = m_size; count > 0;)
+        {
+            const size_t half = count / 2;
+            if (m_keys[index + half] < key)
+            {
+                index += half + 1;
+                count -= half + 1;
+            } else {
+                count = half;
+            }
+        }
+
+        return index;
+    }
+
+    constexpr size_t upperBound(K const& key) const
+    {
+        size_t index = 0;
+        for (size_t count = m_size; count > 0;)
+        {
+            const size_t half = count / 2;
+            if (!(key < m_keys[index + half]))
+            {
+                index += half + 1;
+                count -= half + 1;
+            } else {
+                count = half;
+            }
+        }
+
+        return index;
+    }
+
+    V m_valBegin;
+    std::array<K, N> m_keys{};
+    std::array<V, N> m_values{};
+    size_t m_size = 0;
+};
+
+#endif // INTERVAL_MAP_CONSTEXPR_INTERVAL_MAP_HPP
\ No newline at end of file
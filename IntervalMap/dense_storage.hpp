@@ -0,0 +1,92 @@
+/* Copyright (C) 2024, Valkai-Nmeth Bla-rs */
+
+#ifndef INTERVAL_MAP_DENSE_STORAGE_HPP
+#define INTERVAL_MAP_DENSE_STORAGE_HPP
+
+#include "interval_map.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+// Describes a key type with few enough values to keep one value per key.
+// size is the number of keys and index maps them in order onto [0, size).
+// Specialize it for enums using only a small part of their underlying type.
+template<typename K, typename = void>
+struct dense_key_traits
+{
+    static constexpr bool is_dense = false;
+};
+
+// 8 and 16 bit integers
+template<typename K>
+struct dense_key_traits<K, std::enable_if_t<std::is_integral_v<K> && !std::is_same_v<K, bool> && sizeof(K) <= 2>>
+{
+    static constexpr bool is_dense = true;
+    static constexpr size_t size = size_t(1) << (8 * sizeof(K));
+
+    static size_t index(K key)
+    {
+        return static_cast<size_t>(static_cast<long>(key) - static_cast<long>(std::numeric_limits<K>::min()));
+    }
+};
+
+// Enums with an 8 or 16 bit underlying type
+template<typename K>
+struct dense_key_traits<K, std::enable_if_t<std::is_enum_v<K> && sizeof(K) <= 2>>
+{
+    static constexpr bool is_dense = true;
+    static constexpr size_t size = dense_key_traits<std::underlying_type_t<K>>::size;
+
+    static size_t index(K key)
+    {
+        return dense_key_traits<std::underlying_type_t<K>>::index(static_cast<std::underlying_type_t<K>>(key));
+    }
+};
+
+// Selects the dense backend: interval_map<K, V, dense_storage<K, V>>
+template<typename K, typename V>
+struct dense_storage {};
+
+// interval_map over a key type with few values, keeping one value per key instead
+// of the boundaries. Look-ups are a single array load and assign is a fill, which
+// compilers vectorize for trivially copyable values. Costs dense_key_traits<K>::size
+// values of memory regardless of the contents.
+template<typename K, typename V>
+class interval_map<K, V, dense_storage<K, V>>
+{
+    using traits = dense_key_traits<K>;
+    static_assert(traits::is_dense, "dense_storage needs a key type with dense_key_traits");
+
+protected:
+    std::vector<V> m_values;
+
+    ~interval_map() = default;
+
+public:
+    // constructor associates whole range of K with val
+    interval_map(V const& val)
+        : m_values(traits::size, val)
+    {}
+
+    // Assign value val to interval [keyBegin, keyEnd).
+    // Overwrite previous values in this interval.
+    void assign(K const& keyBegin, K const& keyEnd, V const& val)
+    {
+        if (!(keyBegin < keyEnd))
+        {
+            return;
+        }
+
+        std::fill(m_values.begin() + traits::index(keyBegin), m_values.begin() + traits::index(keyEnd), val);
+    }
+
+    // look-up of the value associated with key
+    V const& operator[](K const& key) const
+    {
+        return m_values[traits::index(key)];
+    }
+};
+
+#endif // INTERVAL_MAP_DENSE_STORAGE_HPP
\ No newline at end of file
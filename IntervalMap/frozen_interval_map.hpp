@@ -0,0 +1,277 @@
+/* Copyright (C) 2024, Valkai-Nmeth Bla-rs */
+
+#ifndef INTERVAL_MAP_FROZEN_INTERVAL_MAP_HPP
+#define INTERVAL_MAP_FROZEN_INTERVAL_MAP_HPP
+
+#include "interval_map.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+// Read only copy of an interval_map with the boundaries in flat sorted arrays,
+// for maps built once and looked up many times. Look-ups binary search the keys
+// unless an interpolation index was built, see build_index().
+template<typename K, typename V>
+class frozen_interval_map
+{
+public:
+    template<typename Map>
+    frozen_interval_map(interval_map<K, V, Map> const& im)
+        : m_valBegin(im.m_valBegin)
+    {
+        m_keys.reserve(im.m_map.size());
+        m_values.reserve(im.m_map.size());
+        for (auto const& entry : im.m_map)
+        {
+            m_keys.push_back(entry.first);
+            m_values.push_back(entry.second);
+        }
+    }
+
+    // look-up of the value associated with key
+    V const& operator[](K const& key) const
+    {
+        size_t next;
+        if constexpr (std::is_arithmetic_v<K>)
+        {
+            next = m_buckets.empty() ? upperBound(0, m_keys.size(), key) : indexedUpperBound(key);
+        } else {
+            next = upperBound(0, m_keys.size(), key);
+        }
+
+        return 0 == next ? m_valBegin : m_values[next - 1];
+    }
+
+    // Index the boundaries of an arithmetic key type for look-ups in about O(1)
+    // when they are roughly uniform. The key range is cut into equal width buckets
+    // and within a bucket the position is interpolated between its first and last
+    // key, then corrected by a search bounded by the bucket's largest error.
+    // Skewed keys make the searched windows grow towards whole buckets, if that
+    // would not beat binary search the index is not kept.
+    void build_index(size_t keysPerBucket = 8)
+    {
+        static_assert(std::is_arithmetic_v<K>, "interpolation needs an arithmetic key type");
+
+        m_buckets.clear();
+        if (m_keys.size() < 2)
+        {
+            return;
+        }
+
+        const size_t bucketCount = std::max<size_t>(1, m_keys.size() / std::max<size_t>(1, keysPerBucket));
+        m_minKey = static_cast<double>(m_keys.front());
+        m_scale = bucketCount / (static_cast<double>(m_keys.back()) - m_minKey);
+        if (!std::isfinite(m_scale))
+        {
+            return;
+        }
+
+        // One more bucket marks the end of the last one
+        m_buckets.resize(bucketCount + 1);
+        size_t index = 0;
+        for (size_t bucket = 0; bucket <= bucketCount; bucket++)
+        {
+            while (index < m_keys.size() && bucketOf(m_keys[index]) < bucket)
+            {
+                index++;
+            }
+
+            m_buckets[bucket].first = index;
+        }
+
+        m_buckets[bucketCount].first = m_keys.size();
+        for (size_t bucket = 0; bucket < bucketCount; bucket++)
+        {
+            bucket_info& info = m_buckets[bucket];
+            const size_t first = info.first;
+            const size_t last = m_buckets[bucket + 1].first;
+            const double span = static_cast<double>(m_keys[last - 1]) - static_cast<double>(m_keys[first]);
+            info.slope = span > 0.0 ? (last - first - 1) / span : 0.0;
+            info.error = 0;
+            for (size_t i = first; i < last; i++)
+            {
+                const size_t predicted = predict(info, last, m_keys[i]);
+                info.error = std::max(info.error, predicted > i ? predicted - i : i - predicted);
+            }
+        }
+
+        // Drop the index when its windows are about as long to search as the whole
+        // array, counting a couple of steps for reaching the bucket and its first key
+        double indexedSteps = 0.0;
+        for (size_t bucket = 0; bucket < bucketCount; bucket++)
+        {
+            const size_t count = m_buckets[bucket + 1].first - m_buckets[bucket].first;
+            const size_t window = std::min(count + 1, 2 * m_buckets[bucket].error + 2);
+            indexedSteps += count * std::log2(static_cast<double>(window) + 1.0);
+        }
+
+        if (indexedSteps / m_keys.size() + 2.0 >= std::log2(static_cast<double>(m_keys.size())))
+        {
+            m_buckets.clear();
+        }
+    }
+
+    bool indexed() const
+    {
+        return !m_buckets.empty();
+    }
+
+    // Largest distance of an indexed prediction from the actual position, 0 without index
+    size_t index_error() const
+    {
+        size_t result = 0;
+        for (auto const& info : m_buckets)
+        {
+            result = std::max(result, info.error);
+        }
+
+        return result;
+    }
+
+    // Look up count keys into out. Without an index a group of keys is searched
+    // at a time, step by step in lockstep and prefetching the keys of the next
+    // step, so the cache misses of the group overlap.
+    void lookup(K const* keys, size_t count, V* out) const
+    {
+        if constexpr (std::is_arithmetic_v<K>)
+        {
+            if (!m_buckets.empty())
+            {
+                for (size_t i = 0; i < count; i++)
+                {
+                    out[i] = (*this)[keys[i]];
+                }
+
+                return;
+            }
+        }
+
+        if (m_keys.empty())
+        {
+            std::fill(out, out + count, m_valBegin);
+            return;
+        }
+
+        const size_t groupSize = 16;
+        for (size_t first = 0; first < count; first += groupSize)
+        {
+            const size_t size = std::min(groupSize, count - first);
+            size_t bases[groupSize] = {};
+            for (size_t span = m_keys.size(); span > 1;)
+            {
+                const size_t half = span / 2;
+                span -= half;
+                for (size_t i = 0; i < size; i++)
+                {
+                    bases[i] = keys[first + i] < m_keys[bases[i] + half] ? bases[i] : bases[i] + half;
+                    prefetch(&m_keys[bases[i] + span / 2]);
+                }
+            }
+
+            for (size_t i = 0; i < size; i++)
+            {
+                out[first + i] = keys[first + i] < m_keys[bases[i]] ? m_valBegin : m_values[bases[i]];
+            }
+        }
+    }
+
+    // Look up count keys sorted in ascending order into out, galloping from the
+    // boundary of one key to the next
+    void lookup_sorted(K const* keys, size_t count, V* out) const
+    {
+        size_t next = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            // Double the step until passing the key, then search the last step
+            size_t step = 1;
+            while (next + step <= m_keys.size() && !(keys[i] < m_keys[next + step - 1]))
+            {
+                step *= 2;
+            }
+
+            next = upperBound(next + step / 2, std::min(next + step, m_keys.size()), keys[i]);
+            out[i] = 0 == next ? m_valBegin : m_values[next - 1];
+        }
+    }
+
+private:
+    static void prefetch(void const* pData)
+    {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+        _mm_prefetch(static_cast<char const*>(pData), _MM_HINT_T0);
+#elif defined(__GNUC__)
+        __builtin_prefetch(pData);
+#else
+        (void)pData;
+#endif
+    }
+
+    struct bucket_info
+    {
+        size_t first = 0;
+        size_t error = 0;
+        double slope = 0.0;
+    };
+
+    size_t upperBound(size_t first, size_t last, K const& key) const
+    {
+        return std::upper_bound(m_keys.begin() + first, m_keys.begin() + last, key) - m_keys.begin();
+    }
+
+    // Monotonic in key, so keys in earlier buckets are all smaller
+    size_t bucketOf(K const& key) const
+    {
+        const double position = (static_cast<double>(key) - m_minKey) * m_scale;
+        const size_t lastBucket = m_buckets.size() - 2;
+        return !(position > 0.0) ? 0 : (position >= lastBucket ? lastBucket : static_cast<size_t>(position));
+    }
+
+    // Monotonic in key within the bucket, clamped to it. Clamped as a double, as
+    // converting one out of the range of size_t is undefined.
+    size_t predict(bucket_info const& info, size_t last, K const& key) const
+    {
+        const double offset = (static_cast<double>(key) - static_cast<double>(m_keys[info.first])) * info.slope;
+        const double span = static_cast<double>(last - info.first);
+        return !(offset > 0.0) ? info.first : (offset >= span ? last : info.first + static_cast<size_t>(offset));
+    }
+
+    size_t indexedUpperBound(K const& key) const
+    {
+        const size_t bucket = bucketOf(key);
+        bucket_info const& info = m_buckets[bucket];
+        const size_t last = m_buckets[bucket + 1].first;
+        if (info.first == last)
+        {
+            return last;
+        }
+
+        if (2 * info.error + 1 >= last - info.first)
+        {
+            // Crowded bucket the prediction does not help in
+            return upperBound(info.first, last, key);
+        }
+
+        // The answer is within error of the prediction, give or take the one
+        // position between the neighbouring keys
+        const size_t predicted = predict(info, last, key);
+        const size_t windowFirst = predicted - info.first > info.error ? predicted - info.error : info.first;
+        const size_t windowLast = std::min(last, predicted + info.error + 1);
+        return upperBound(windowFirst, windowLast, key);
+    }
+
+    V m_valBegin;
+    std::vector<K> m_keys;
+    std::vector<V> m_values;
+
+    std::vector<bucket_info> m_buckets;
+    double m_minKey = 0.0;
+    double m_scale = 0.0;
+};
+
+#endif // INTERVAL_MAP_FROZEN_INTERVAL_MAP_HPP
\ No newline at end of file
@@ -0,0 +1,151 @@
+/* Copyright (C) 2024, Valkai-Nmeth Bla-rs */
+
+#ifndef INTERVAL_MAP_FROZEN_QUERY_ENGINE_HPP
+#define INTERVAL_MAP_FROZEN_QUERY_ENGINE_HPP
+
+#include "frozen_interval_map.hpp"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Resolves large arrays of keys against a frozen_interval_map on a pool of
+// threads. The keys are cut into chunks the threads take in turn, and every
+// chunk is looked up the fastest way it allows: sorted chunks by galloping
+// along the boundaries, others by prefetched batch search.
+template<typename K, typename V>
+class frozen_query_engine
+{
+public:
+    // The map must outlive the engine. The calling thread works too, so
+    // threadCount - 1 threads are started.
+    frozen_query_engine(frozen_interval_map<K, V> const& im, unsigned threadCount = std::thread::hardware_concurrency(), size_t chunkSize = 1 << 14)
+        : m_im(im)
+        , m_chunkSize(std::max<size_t>(1, chunkSize))
+    {
+        for (unsigned i = 1; i < threadCount; i++)
+        {
+            m_threads.emplace_back([this]() { work(); });
+        }
+    }
+
+    frozen_query_engine(frozen_query_engine const&) = delete;
+    frozen_query_engine& operator=(frozen_query_engine const&) = delete;
+
+    ~frozen_query_engine()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+
+        m_wake.notify_all();
+        for (auto& thread : m_threads)
+        {
+            thread.join();
+        }
+    }
+
+    // Write the value of keys[i] to out[i] for every i below count
+    void resolve(K const* keys, size_t count, V* out)
+    {
+        auto job = std::make_shared<batch>(keys, count, out, (count + m_chunkSize - 1) / m_chunkSize);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_batch = job;
+        }
+
+        m_wake.notify_all();
+        resolveChunks(*job);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [&]() { return job->chunksDone == job->chunkCount; });
+    }
+
+    unsigned thread_count() const
+    {
+        return static_cast<unsigned>(m_threads.size()) + 1;
+    }
+
+private:
+    // One resolve() call, the chunks are handed out by nextChunk. Threads late
+    // for a batch find its chunks gone and cannot take any of the next one.
+    struct batch
+    {
+        batch(K const* keys, size_t count, V* out, size_t chunkCount)
+            : keys(keys)
+            , count(count)
+            , out(out)
+            , chunkCount(chunkCount)
+        {}
+
+        K const* keys;
+        size_t count;
+        V* out;
+        size_t chunkCount;
+        std::atomic<size_t> nextChunk{ 0 };
+        size_t chunksDone = 0;
+    };
+
+    void work()
+    {
+        std::shared_ptr<batch> job;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wake.wait(lock, [&]() { return m_stopping || m_batch != job; });
+                if (m_stopping)
+                {
+                    return;
+                }
+
+                job = m_batch;
+            }
+
+            resolveChunks(*job);
+        }
+    }
+
+    void resolveChunks(batch& job)
+    {
+        size_t resolved = 0;
+        for (size_t chunk; (chunk = job.nextChunk++) < job.chunkCount; resolved++)
+        {
+            const size_t first = chunk * m_chunkSize;
+            const size_t count = std::min(m_chunkSize, job.count - first);
+            if (std::is_sorted(job.keys + first, job.keys + first + count))
+            {
+                m_im.lookup_sorted(job.keys + first, count, job.out + first);
+            } else {
+                m_im.lookup(job.keys + first, count, job.out + first);
+            }
+        }
+
+        if (resolved)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            job.chunksDone += resolved;
+            if (job.chunksDone == job.chunkCount)
+            {
+                m_done.notify_all();
+            }
+        }
+    }
+
+    frozen_interval_map<K, V> const& m_im;
+    size_t m_chunkSize;
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    bool m_stopping = false;
+    std::shared_ptr<batch> m_batch;
+};
+
+#endif // INTERVAL_MAP_FROZEN_QUERY_ENGINE_HPP
\ No newline at end of file
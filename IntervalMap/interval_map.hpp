@@ -3,17 +3,175 @@
 #ifndef INTERVAL_MAP_HPP
 #define INTERVAL_MAP_HPP
 
+#include <cassert>
 #include <map>
+#include <iterator>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Map types that can split and join themselves cheaply, like treap_map
+template<typename Map, typename = void>
+struct has_split_join : std::false_type {};
+
+template<typename Map>
+struct has_split_join<Map, std::void_t<decltype(std::declval<Map&>().join(std::declval<Map&>()))>> : std::true_type {};
+
+// Map types with std::map like node handles, extract() and insert(hint, node)
+template<typename Map, typename = void>
+struct has_node_handles : std::false_type {};
+
+template<typename Map>
+struct has_node_handles<Map, std::void_t<typename Map::node_type>> : std::true_type {};
+
+template<typename Map, typename = void>
+struct map_node_type
+{
+    // Placeholder, never used
+    using type = int;
+};
+
+template<typename Map>
+struct map_node_type<Map, std::void_t<typename Map::node_type>>
+{
+    using type = typename Map::node_type;
+};
+
+// Map types with a transparent comparator, able to look up keys of other types
+template<typename Map, typename = void>
+struct has_transparent_compare : std::false_type {};
+
+template<typename Map>
+struct has_transparent_compare<Map, std::void_t<typename Map::key_compare::is_transparent>> : std::true_type {};
+
+template<typename K, typename V>
+class frozen_interval_map;
 
 template<typename K, typename V>
+class packed_interval_map;
+
+// Map is the ordered container holding the boundaries. It must provide the parts
+// of the std::map interface used below, see treap_map and small_map for alternatives.
+template<typename K, typename V, typename Map = std::map<K, V>>
 class interval_map
 {
+    template<typename, typename, typename> friend class interval_map;
+    friend class frozen_interval_map<K, V>;
+    friend class packed_interval_map<K, V>;
+
 protected:
     V m_valBegin;
-    std::map<K, V> m_map;
+    Map m_map;
 
     ~interval_map() = default;
 
+    // Sorted boundaries, each one either starting a value or, when the value is
+    // nullptr, uncovering the current contents of the map again
+    using painting = std::vector<std::pair<K const*, V const*>>;
+
+    // Apply a painting on top of the underlying map walking both once. Map entries
+    // are only touched where the painting changes them, and if Map has node handles
+    // the nodes of painted over entries are reused for new ones.
+    void paint(painting const& boundaries)
+    {
+        auto it = m_map.begin();
+        std::vector<typename map_node_type<Map>::type> spareNodes;
+
+        // Original value of the underlying map at the current position
+        V const* base = &m_valBegin;
+        std::optional<V> savedBase;
+
+        // Value in effect in the merged map right before the current position
+        V const* emitted = &m_valBegin;
+
+        V const* over = nullptr;
+        for (auto const& boundary : boundaries)
+        {
+            K const& key = *boundary.first;
+
+            // Entries up to the boundary are either kept as they are or painted over
+            bool kept = false;
+            while (m_map.end() != it && it->first < key)
+            {
+                if (over)
+                {
+                    auto nextIt = std::next(it);
+                    if (m_map.end() == nextIt || !(nextIt->first < key))
+                    {
+                        base = &savedBase.emplace(it->second);
+                    }
+
+                    if constexpr (has_node_handles<Map>::value)
+                    {
+                        spareNodes.push_back(m_map.extract(it));
+                        it = nextIt;
+                    } else {
+                        it = m_map.erase(it);
+                    }
+                } else {
+                    base = &it->second;
+                    emitted = base;
+                    kept = true;
+                    ++it;
+                }
+            }
+
+            if (kept)
+            {
+                // Inserting may move the entries if Map is not node based
+                base = &savedBase.emplace(*base);
+            }
+
+            const bool foundEntryAtKey = m_map.end() != it && !(key < it->first);
+            if (foundEntryAtKey)
+            {
+                // The entry may be overwritten or erased below
+                base = &savedBase.emplace(it->second);
+            }
+
+            V const* val = boundary.second ? boundary.second : base;
+            if (*val == *emitted)
+            {
+                if (foundEntryAtKey)
+                {
+                    it = m_map.erase(it);
+                }
+            } else if (foundEntryAtKey) {
+                if (boundary.second)
+                {
+                    it->second = *val;
+                }
+
+                emitted = &it->second;
+                ++it;
+            } else {
+                auto inserted = m_map.end();
+                if constexpr (has_node_handles<Map>::value)
+                {
+                    if (!spareNodes.empty())
+                    {
+                        auto node = std::move(spareNodes.back());
+                        spareNodes.pop_back();
+                        node.key() = key;
+                        node.mapped() = *val;
+                        inserted = m_map.insert(it, std::move(node));
+                    }
+                }
+
+                if (m_map.end() == inserted)
+                {
+                    inserted = m_map.emplace_hint(it, key, *val);
+                }
+
+                emitted = &inserted->second;
+                it = std::next(inserted);
+            }
+
+            over = boundary.second;
+        }
+    }
+
 public:
     // constructor associates whole range of K with val
     interval_map(V const& val)
@@ -23,6 +181,71 @@ public:
     // Assign value val to interval [keyBegin, keyEnd).
     // Overwrite previous values in this interval.
     void assign(K const& keyBegin, K const& keyEnd, V const& val)
+    {
+        assignKeys(keyBegin, keyEnd, val);
+    }
+
+    // With a transparent comparator, like std::map<K, V, std::less<>>, keys of
+    // any type comparable with K. A K is only made for boundaries inserted.
+    // Raw pointers and arrays would be ordered by address, they go through K.
+    template<typename Key, typename = std::enable_if_t<has_transparent_compare<Map>::value && !std::is_same_v<Key, K> && !std::is_pointer_v<std::decay_t<Key>>>>
+    void assign(Key const& keyBegin, Key const& keyEnd, V const& val)
+    {
+        assignKeys(keyBegin, keyEnd, val);
+    }
+
+    // look-up of the value associated with key
+    V const& operator[](K const& key) const
+    {
+        return find(key);
+    }
+
+    // With a transparent comparator, look-up by any type comparable with K
+    // without making a temporary K
+    template<typename Key, typename = std::enable_if_t<has_transparent_compare<Map>::value && !std::is_same_v<Key, K>>>
+    V const& operator[](Key const& key) const
+    {
+        return find(key);
+    }
+
+    // Reset [keyBegin, keyEnd) to the initial value. The entries in the range go
+    // with one range erase, then at most one boundary is put back at each end.
+    void reset(K const& keyBegin, K const& keyEnd)
+    {
+        if (!(keyBegin < keyEnd))
+        {
+            return;
+        }
+
+        // Entries at keyEnd go too, the value in effect there is put back if needed
+        auto first = m_map.lower_bound(keyBegin);
+        auto last = m_map.upper_bound(keyEnd);
+        const V valueBeforeKeyBegin = m_map.begin() == first ? m_valBegin : std::prev(first)->second;
+        const V valueForKeyEnd = m_map.begin() == last ? m_valBegin : std::prev(last)->second;
+
+        // Tearing the whole map down skips rebalancing after every node
+        auto it = m_map.end();
+        if (m_map.begin() == first && m_map.end() == last)
+        {
+            m_map.clear();
+        } else {
+            it = m_map.erase(first, last);
+        }
+
+        if (!(valueForKeyEnd == m_valBegin))
+        {
+            it = m_map.emplace_hint(it, keyEnd, valueForKeyEnd);
+        }
+
+        if (!(valueBeforeKeyBegin == m_valBegin))
+        {
+            m_map.emplace_hint(it, keyBegin, m_valBegin);
+        }
+    }
+
+private:
+    template<typename Key>
+    void assignKeys(Key const& keyBegin, Key const& keyEnd, V const& val)
     {
         if (!(keyBegin < keyEnd))
         {
@@ -58,7 +281,12 @@ public:
                         m_map.emplace_hint(it, keyEnd, valueBeforeKeyBegin);
                         return;
                     } else if (!(it->first < keyEnd)) { //&& !(keyEnd < it->first)) {
-                        // Conflicts at end, but with right value
+                        // Conflicts at end, entry there is redundant if it has the same value
+                        if (it->second == val)
+                        {
+                            it = m_map.erase(it);
+                        }
+
                         m_map.emplace_hint(it, keyBegin, val);
                         return;
                     }
@@ -99,8 +327,8 @@ public:
         }
     }
 
-    // look-up of the value associated with key
-    V const& operator[](K const& key) const
+    template<typename Key>
+    V const& find(Key const& key) const
     {
         auto it = m_map.upper_bound(key);
         if (it == m_map.begin())
@@ -112,6 +340,312 @@ public:
             return (--it)->second;
         }
     }
+
+public:
+    // Paint overrides on top, wherever it differs from its own initial value.
+    // Walks both maps once, entries are only touched where they change.
+    template<typename OverridesMap>
+    void overlay(interval_map<K, V, OverridesMap> const& overrides)
+    {
+        if (static_cast<void const*>(&overrides) == this)
+        {
+            return;
+        }
+
+        painting boundaries;
+        boundaries.reserve(overrides.m_map.size());
+        for (auto const& entry : overrides.m_map)
+        {
+            boundaries.emplace_back(&entry.first, entry.second == overrides.m_valBegin ? nullptr : &entry.second);
+        }
+
+        paint(boundaries);
+    }
+
+    // Replace contents with combine(a[key], b[key]) for every key, walking both
+    // maps once and emitting the canonical result directly
+    template<typename VA, typename MapA, typename VB, typename MapB, typename Combine>
+    void combine(interval_map<K, VA, MapA> const& a, interval_map<K, VB, MapB> const& b, Combine combine)
+    {
+        Map result;
+        V valBegin = combine(a.m_valBegin, b.m_valBegin);
+        V const* current = &valBegin;
+
+        auto itA = a.m_map.begin();
+        auto itB = b.m_map.begin();
+        VA const* valA = &a.m_valBegin;
+        VB const* valB = &b.m_valBegin;
+        while (a.m_map.end() != itA || b.m_map.end() != itB)
+        {
+            K const* key;
+            if (b.m_map.end() == itB || (a.m_map.end() != itA && itA->first < itB->first))
+            {
+                key = &itA->first;
+                valA = &(itA++)->second;
+            } else if (a.m_map.end() == itA || itB->first < itA->first) {
+                key = &itB->first;
+                valB = &(itB++)->second;
+            } else {
+                key = &itA->first;
+                valA = &(itA++)->second;
+                valB = &(itB++)->second;
+            }
+
+            V val = combine(*valA, *valB);
+            if (!(val == *current))
+            {
+                current = &result.emplace_hint(result.end(), *key, std::move(val))->second;
+            }
+        }
+
+        m_valBegin = std::move(valBegin);
+        m_map.swap(result);
+    }
+
+    // Replace contents with the pairs (a[key], b[key])
+    template<typename VA, typename MapA, typename VB, typename MapB>
+    void zip(interval_map<K, VA, MapA> const& a, interval_map<K, VB, MapB> const& b)
+    {
+        combine(a, b, [](VA const& valA, VB const& valB) { return V(valA, valB); });
+    }
+
+    // Write turning one map into another, see diff()
+    struct change
+    {
+        change(K const& keyBegin, K const& keyEnd, V const& val)
+            : keyBegin(keyBegin)
+            , keyEnd(keyEnd)
+            , val(val)
+        {}
+
+        K keyBegin;
+        K keyEnd;
+        V val;
+    };
+
+    // Writes which, fed to assign() in any order, turn this map into target.
+    // Walks both maps once and emits one write per stretch where the maps differ
+    // and target's value is constant, so no key that already matches is written.
+    // Both maps must have the same initial value, as no write reaches the ends.
+    template<typename TargetMap>
+    std::vector<change> diff(interval_map<K, V, TargetMap> const& target) const
+    {
+        assert(m_valBegin == target.m_valBegin);
+
+        std::vector<change> result;
+        auto itA = m_map.begin();
+        auto itB = target.m_map.begin();
+        V const* valA = &m_valBegin;
+        V const* valB = &target.m_valBegin;
+
+        // Start of the stretch being written, if any
+        K const* writeBegin = nullptr;
+        while (m_map.end() != itA || target.m_map.end() != itB)
+        {
+            K const* key;
+            V const* prevB = valB;
+            if (target.m_map.end() == itB || (m_map.end() != itA && itA->first < itB->first))
+            {
+                key = &itA->first;
+                valA = &(itA++)->second;
+            } else if (m_map.end() == itA || itB->first < itA->first) {
+                key = &itB->first;
+                valB = &(itB++)->second;
+            } else {
+                key = &itA->first;
+                valA = &(itA++)->second;
+                valB = &(itB++)->second;
+            }
+
+            if (writeBegin && (*valA == *valB || !(*valB == *prevB)))
+            {
+                result.emplace_back(*writeBegin, *key, *prevB);
+                writeBegin = nullptr;
+            }
+
+            if (!writeBegin && !(*valA == *valB))
+            {
+                writeBegin = key;
+            }
+        }
+
+        return result;
+    }
+
+    // Move the part of the map at and after key into right, replacing its contents.
+    // Both sides keep the values of their part and have the initial value elsewhere.
+    // Expected O(log n) if Map can split itself, linear in the moved entries otherwise.
+    void split(K const& key, interval_map& right)
+    {
+        right.m_valBegin = m_valBegin;
+        right.m_map.clear();
+
+        auto it = m_map.lower_bound(key);
+        V const* valueBeforeKey = m_map.begin() == it ? &m_valBegin : &std::prev(it)->second;
+
+        if constexpr (has_split_join<Map>::value)
+        {
+            m_map.split(key, right.m_map);
+        } else if constexpr (has_node_handles<Map>::value) {
+            while (m_map.end() != it)
+            {
+                auto nextIt = std::next(it);
+                right.m_map.insert(right.m_map.end(), m_map.extract(it));
+                it = nextIt;
+            }
+        } else {
+            for (auto moveIt = it; m_map.end() != moveIt; ++moveIt)
+            {
+                right.m_map.emplace_hint(right.m_map.end(), moveIt->first, moveIt->second);
+            }
+
+            m_map.erase(it, m_map.end());
+        }
+
+        // Right side starts with the value in effect at key
+        auto first = right.m_map.begin();
+        if (right.m_map.end() != first && !(key < first->first))
+        {
+            if (first->second == m_valBegin)
+            {
+                right.m_map.erase(first);
+            }
+        } else if (!(*valueBeforeKey == m_valBegin)) {
+            right.m_map.emplace_hint(first, key, *valueBeforeKey);
+        }
+
+        // Left side goes back to the initial value at key
+        if (!m_map.empty() && !(m_map.rbegin()->second == m_valBegin))
+        {
+            m_map.emplace_hint(m_map.end(), key, m_valBegin);
+        }
+    }
+
+    // Append right, which must have the same initial value and all its entries at
+    // or after the ones in this map, leaving right empty. The inverse of split().
+    // Expected O(log n) if Map can join itself, linear in the moved entries otherwise.
+    void join(interval_map& right)
+    {
+        assert(m_valBegin == right.m_valBegin);
+        assert(m_map.empty() || right.m_map.empty() || !(right.m_map.begin()->first < m_map.rbegin()->first));
+
+        if (!m_map.empty() && !right.m_map.empty())
+        {
+            auto last = std::prev(m_map.end());
+            auto first = right.m_map.begin();
+            if (!(last->first < first->first))
+            {
+                // Both have a boundary at the seam, ours only goes back to the initial value
+                last = m_map.erase(last);
+                if (std::prev(last)->second == first->second)
+                {
+                    right.m_map.erase(first);
+                }
+            }
+        }
+
+        if constexpr (has_split_join<Map>::value)
+        {
+            m_map.join(right.m_map);
+        } else if constexpr (has_node_handles<Map>::value) {
+            while (!right.m_map.empty())
+            {
+                m_map.insert(m_map.end(), right.m_map.extract(right.m_map.begin()));
+            }
+        } else {
+            for (auto const& entry : right.m_map)
+            {
+                m_map.emplace_hint(m_map.end(), entry.first, entry.second);
+            }
+
+            right.m_map.clear();
+        }
+    }
+
+    // Rebuild the map in key order into a fresh Map, in linear time, the mapping
+    // stays the same. Node based maps get their nodes allocated one after another,
+    // which with pool_allocator lays them out contiguously in key order and hands
+    // the blocks scattered by churn back. The values are copied, so an allocation
+    // throwing midway leaves the map as it was.
+    void compact()
+    {
+        Map fresh;
+        for (auto const& entry : m_map)
+        {
+            fresh.emplace_hint(fresh.end(), entry.first, entry.second);
+        }
+
+        m_map = std::move(fresh);
+    }
+
+    // Finger into the map that remembers the interval of the last look-up.
+    // Consecutive keys landing in the same or a neighbouring interval are
+    // answered without a full search. Any assign invalidates the cursor.
+    class cursor
+    {
+    public:
+        cursor(interval_map const& im)
+            : m_im(im)
+            , m_next(im.m_map.begin())
+        {}
+
+        V const& operator[](K const& key)
+        {
+            return find(key);
+        }
+
+        // With a transparent comparator, look-up by any type comparable with K
+        template<typename Key, typename = std::enable_if_t<has_transparent_compare<Map>::value && !std::is_same_v<Key, K>>>
+        V const& operator[](Key const& key)
+        {
+            return find(key);
+        }
+
+    private:
+        template<typename Key>
+        V const& find(Key const& key)
+        {
+            auto const& map = m_im.m_map;
+
+            if (!isBelowNext(key))
+            {
+                // Try the interval right after the cached one first
+                ++m_next;
+                if (!isBelowNext(key))
+                {
+                    m_next = map.upper_bound(key);
+                }
+            } else if (!isAtOrAfterPrev(key)) {
+                // Then the one right before it
+                --m_next;
+                if (!isAtOrAfterPrev(key))
+                {
+                    m_next = map.upper_bound(key);
+                }
+            }
+
+            return map.begin() == m_next ? m_im.m_valBegin : std::prev(m_next)->second;
+        }
+
+        // key < start of the interval after the cached one
+        template<typename Key>
+        bool isBelowNext(Key const& key) const
+        {
+            return m_im.m_map.end() == m_next || key < m_next->first;
+        }
+
+        // key >= start of the cached interval
+        template<typename Key>
+        bool isAtOrAfterPrev(Key const& key) const
+        {
+            return m_im.m_map.begin() == m_next || !(key < std::prev(m_next)->first);
+        }
+
+        interval_map const& m_im;
+
+        // First entry after the cached interval, as upper_bound would return it
+        typename Map::const_iterator m_next;
+    };
 };
 
 #endif // INTERVAL_MAP_HPP
@@ -0,0 +1,203 @@
+/* Copyright (C) 2024, Valkai-Nmeth Bla-rs */
+
+#ifndef INTERVAL_MAP_INTERVAL_MULTIMAP_HPP
+#define INTERVAL_MAP_INTERVAL_MULTIMAP_HPP
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+// Keeps every interval [keyBegin, keyEnd) inserted with its value, overlapping
+// or not, unlike interval_map where later assigns paint over earlier ones.
+// After build() it answers which intervals contain a key or intersect a range in
+// O((k + 1) log n) for k results. The intervals are sorted by keyBegin into an array
+// read as an implicit balanced search tree, the middle of every run being the
+// parent of the two halves, each node augmented with the largest keyEnd below it.
+template<typename K, typename V>
+class interval_multimap
+{
+public:
+    struct entry
+    {
+        entry(K const& keyBegin, K const& keyEnd, V const& val)
+            : keyBegin(keyBegin)
+            , keyEnd(keyEnd)
+            , val(val)
+        {}
+
+        K keyBegin;
+        K keyEnd;
+        V val;
+    };
+
+    interval_multimap() = default;
+
+    // Bulk build from unsorted entries
+    interval_multimap(std::vector<entry> entries)
+        : m_entries(std::move(entries))
+    {
+        m_entries.erase(std::remove_if(m_entries.begin(), m_entries.end(), [](entry const& e) { return !(e.keyBegin < e.keyEnd); }), m_entries.end());
+        build();
+    }
+
+    // Add interval [keyBegin, keyEnd), queries need build() again
+    void insert(K const& keyBegin, K const& keyEnd, V const& val)
+    {
+        if (keyBegin < keyEnd)
+        {
+            m_entries.emplace_back(keyBegin, keyEnd, val);
+            m_built = false;
+        }
+    }
+
+    // Sort the intervals and index them, O(n log n)
+    void build()
+    {
+        std::sort(m_entries.begin(), m_entries.end(), [](entry const& lhs, entry const& rhs) { return lhs.keyBegin < rhs.keyBegin; });
+        indexMaxEnds();
+        m_built = true;
+    }
+
+    // Call fn with every interval containing key
+    template<typename Fn>
+    void for_each_containing(K const& key, Fn fn) const
+    {
+        visit(key, [&key](K const& keyBegin) { return !(key < keyBegin); }, fn);
+    }
+
+    // Call fn with every interval intersecting [keyBegin, keyEnd)
+    template<typename Fn>
+    void for_each_overlapping(K const& keyBegin, K const& keyEnd, Fn fn) const
+    {
+        if (keyBegin < keyEnd)
+        {
+            visit(keyBegin, [&keyEnd](K const& begin) { return begin < keyEnd; }, fn);
+        }
+    }
+
+    size_t size() const
+    {
+        return m_entries.size();
+    }
+
+private:
+    // Node i is on the level of its trailing one bits, level k nodes are 2^(k+1)
+    // apart starting at 2^k - 1, with children 2^(k-1) below and above them.
+    // Positions past the end are imaginary nodes whose subtree may still hold
+    // real ones, their largest keyEnd is the one of the last real subtree.
+    void indexMaxEnds()
+    {
+        const size_t n = m_entries.size();
+        m_maxEnds.clear();
+        m_levels = 0;
+        if (0 == n)
+        {
+            return;
+        }
+
+        m_maxEnds.reserve(n);
+        for (auto const& e : m_entries)
+        {
+            m_maxEnds.push_back(e.keyEnd);
+        }
+
+        size_t lastIndex = (n - 1) & ~size_t(1);
+        K last = m_maxEnds[lastIndex];
+        size_t level = 1;
+        for (; (size_t(1) << level) <= n; level++)
+        {
+            const size_t half = size_t(1) << (level - 1);
+            for (size_t i = 2 * half - 1; i < n; i += 4 * half)
+            {
+                K const& left = m_maxEnds[i - half];
+                K const& right = i + half < n ? m_maxEnds[i + half] : last;
+                if (m_maxEnds[i] < left)
+                {
+                    m_maxEnds[i] = left;
+                }
+
+                if (m_maxEnds[i] < right)
+                {
+                    m_maxEnds[i] = right;
+                }
+            }
+
+            // Step up from the last real subtree to its parent
+            lastIndex = (lastIndex >> level & 1) ? lastIndex - half : lastIndex + half;
+            if (lastIndex < n && last < m_maxEnds[lastIndex])
+            {
+                last = m_maxEnds[lastIndex];
+            }
+        }
+
+        m_levels = level;
+    }
+
+    // Depth first from the root, skipping subtrees ending at or before key and
+    // right subtrees once intervals start too late
+    template<typename StartsInTime, typename Fn>
+    void visit(K const& key, StartsInTime startsInTime, Fn& fn) const
+    {
+        assert(m_built && "build() before querying");
+
+        const size_t n = m_entries.size();
+        if (0 == n)
+        {
+            return;
+        }
+
+        struct frame
+        {
+            size_t index;
+            size_t level;
+            bool leftDone;
+        };
+
+        frame stack[64];
+        size_t top = 0;
+        stack[top++] = { (size_t(1) << (m_levels - 1)) - 1, m_levels - 1, false };
+        while (top)
+        {
+            const frame current = stack[--top];
+            if (current.level <= 3)
+            {
+                // Small subtree, scan it in order
+                const size_t first = current.index >> current.level << current.level;
+                const size_t last = std::min(n, first + (size_t(1) << (current.level + 1)) - 1);
+                for (size_t i = first; i < last && startsInTime(m_entries[i].keyBegin); i++)
+                {
+                    if (key < m_entries[i].keyEnd)
+                    {
+                        fn(m_entries[i]);
+                    }
+                }
+            } else if (!current.leftDone) {
+                const size_t left = current.index - (size_t(1) << (current.level - 1));
+                stack[top++] = { current.index, current.level, true };
+                if (left >= n || key < m_maxEnds[left])
+                {
+                    stack[top++] = { left, current.level - 1, false };
+                }
+            } else if (current.index < n && startsInTime(m_entries[current.index].keyBegin)) {
+                if (key < m_entries[current.index].keyEnd)
+                {
+                    fn(m_entries[current.index]);
+                }
+
+                const size_t right = current.index + (size_t(1) << (current.level - 1));
+                if (right >= n || key < m_maxEnds[right])
+                {
+                    stack[top++] = { right, current.level - 1, false };
+                }
+            }
+        }
+    }
+
+    std::vector<entry> m_entries;
+    std::vector<K> m_maxEnds;
+    size_t m_levels = 0;
+    bool m_built = true;
+};
+
+#endif // INTERVAL_MAP_INTERVAL_MULTIMAP_HPP
\ No newline at end of file
@@ -0,0 +1,551 @@
+/* Copyright (C) 2024, Valkai-Nmeth Bla-rs */
+
+#ifndef INTERVAL_MAP_INTERVAL_SET_HPP
+#define INTERVAL_MAP_INTERVAL_SET_HPP
+
+#include "interval_map.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Selects the interval set backend: interval_map<K, bool, set_storage<K>>
+template<typename K>
+struct set_storage {};
+
+// interval_map from K to bool keeping only the keys where membership flips.
+// A key is in the set if the number of flips at or before it is odd, or even
+// when the whole range starts out in the set. Union, intersection, difference
+// and complement with another set walk both sets once.
+// Keys of 32 bits or more are cut into chunks of 4096 keys, and chunks with so
+// many flips that a bitmap is smaller are kept as a bitmap of their keys.
+// Flips outside those chunks are kept as if the chunks had no flips at all.
+template<typename K>
+class interval_map<K, bool, set_storage<K>>
+{
+    static constexpr bool has_chunks = std::is_integral_v<K> && sizeof(K) >= 4;
+    static constexpr size_t chunkSize = 4096;
+    using unsigned_key = typename std::conditional_t<has_chunks, std::make_unsigned<K>, std::common_type<size_t>>::type;
+
+protected:
+    struct chunk
+    {
+        K first;
+        uint64_t bits[chunkSize / 64];
+    };
+
+    bool m_valBegin;
+    std::vector<K> m_flips;
+    std::vector<chunk> m_chunks;
+
+    ~interval_map() = default;
+
+public:
+    // constructor associates whole range of K with val
+    interval_map(bool val)
+        : m_valBegin(val)
+    {}
+
+    // Assign value val to interval [keyBegin, keyEnd).
+    // Overwrite previous values in this interval.
+    void assign(K const& keyBegin, K const& keyEnd, bool val)
+    {
+        if (!(keyBegin < keyEnd))
+        {
+            return;
+        }
+
+        if constexpr (has_chunks)
+        {
+            auto chunkIt = std::lower_bound(m_chunks.begin(), m_chunks.end(), chunkFirst(keyBegin), [](chunk const& lhs, K const& rhs) { return lhs.first < rhs; });
+            if (m_chunks.end() != chunkIt && chunkIt->first == chunkFirst(keyBegin))
+            {
+                // Inside one bitmap, up to its end at the most
+                if (chunkIt->first == chunkFirst(keyEnd))
+                {
+                    setBits(*chunkIt, offset(keyBegin), offset(keyEnd), val);
+                    return;
+                } else if (!isLastChunk(chunkIt->first) && chunkEnd(chunkIt->first) == keyEnd) {
+                    setBits(*chunkIt, offset(keyBegin), chunkSize, val);
+                    return;
+                }
+            }
+
+            if (m_chunks.end() != chunkIt && !(keyEnd < chunkIt->first))
+            {
+                // Overlaps bitmaps, encode the chunks from keyBegin to keyEnd again
+                std::vector<K> range{ keyBegin, keyEnd };
+                combine(chunkFirst(keyBegin), chunkFirst(keyEnd), range, [val](bool in, bool inRange) { return inRange ? val : in; });
+                return;
+            }
+        }
+
+        // Outside the bitmaps flips can be edited directly
+        auto first = std::lower_bound(m_flips.begin(), m_flips.end(), keyBegin);
+        auto last = std::upper_bound(first, m_flips.end(), keyEnd);
+        const bool before = m_valBegin != bool((first - m_flips.begin()) & 1);
+        const bool after = m_valBegin != bool((last - m_flips.begin()) & 1);
+        first = m_flips.erase(first, last);
+        if (before != val)
+        {
+            first = std::next(m_flips.insert(first, keyBegin));
+        }
+
+        if (val != after)
+        {
+            m_flips.insert(first, keyEnd);
+        }
+
+        if constexpr (has_chunks)
+        {
+            if (tooManyFlips(keyBegin) || tooManyFlips(keyEnd))
+            {
+                combine(chunkFirst(keyBegin), chunkFirst(keyEnd), std::vector<K>(), [](bool in, bool) { return in; });
+            }
+        }
+    }
+
+    // look-up of the value associated with key
+    bool const& operator[](K const& key) const
+    {
+        return s_values[contains(key)];
+    }
+
+    bool contains(K const& key) const
+    {
+        if constexpr (has_chunks)
+        {
+            if (!m_chunks.empty())
+            {
+                const K first = chunkFirst(key);
+                auto it = std::lower_bound(m_chunks.begin(), m_chunks.end(), first, [](chunk const& lhs, K const& rhs) { return lhs.first < rhs; });
+                if (m_chunks.end() != it && it->first == first)
+                {
+                    return testBit(*it, offset(key));
+                }
+            }
+        }
+
+        return m_valBegin != bool((std::upper_bound(m_flips.begin(), m_flips.end(), key) - m_flips.begin()) & 1);
+    }
+
+    // Write whether keys[i] is in the set to out[i] for every i below count.
+    // Ascending runs of keys continue searching from the previous key.
+    void contains(K const* keys, size_t count, bool* out) const
+    {
+        auto flipIt = m_flips.begin();
+        for (size_t i = 0; i < count; i++)
+        {
+            K const& key = keys[i];
+            if (0 == i || key < keys[i - 1])
+            {
+                flipIt = m_flips.begin();
+            }
+
+            if (!m_chunks.empty())
+            {
+                out[i] = contains(key);
+                continue;
+            }
+
+            // Gallop ahead of the previous position, then search the last step
+            size_t step = 1;
+            auto bound = flipIt;
+            while (m_flips.end() - bound > static_cast<std::ptrdiff_t>(step) && !(key < bound[step]))
+            {
+                bound += step;
+                step *= 2;
+            }
+
+            flipIt = std::upper_bound(bound, m_flips.end() - bound > static_cast<std::ptrdiff_t>(step) ? bound + step + 1 : m_flips.end(), key);
+            out[i] = m_valBegin != bool((flipIt - m_flips.begin()) & 1);
+        }
+    }
+
+    // Keys where membership flips, ascending, and none where it does not
+    std::vector<K> flips() const
+    {
+        std::vector<K> result;
+        result.reserve(m_flips.size());
+        bool actual = m_valBegin;
+        bool masked = m_valBegin;
+        auto emit = [&](K const& key, bool state)
+        {
+            if (state != actual)
+            {
+                result.push_back(key);
+                actual = state;
+            }
+        };
+
+        auto flipIt = m_flips.begin();
+        for (chunk const& bitmap : m_chunks)
+        {
+            if constexpr (has_chunks)
+            {
+                for (; m_flips.end() != flipIt && *flipIt < bitmap.first; ++flipIt)
+                {
+                    masked = !masked;
+                    emit(*flipIt, masked);
+                }
+
+                for (size_t word = 0; word < chunkSize / 64; word++)
+                {
+                    const uint64_t bits = bitmap.bits[word];
+                    for (uint64_t changes = bits ^ ((bits << 1) | (actual ? 1 : 0)); changes; changes &= changes - 1)
+                    {
+                        result.push_back(static_cast<K>(static_cast<unsigned_key>(bitmap.first) + word * 64 + lowestBit(changes)));
+                        actual = !actual;
+                    }
+                }
+
+                if (!isLastChunk(bitmap.first))
+                {
+                    const K end = chunkEnd(bitmap.first);
+                    if (m_flips.end() != flipIt && !(end < *flipIt))
+                    {
+                        masked = !masked;
+                        ++flipIt;
+                    }
+
+                    emit(end, masked);
+                }
+            }
+        }
+
+        for (; m_flips.end() != flipIt; ++flipIt)
+        {
+            masked = !masked;
+            emit(*flipIt, masked);
+        }
+
+        return result;
+    }
+
+    // Number of chunks kept as bitmaps
+    size_t bitmap_count() const
+    {
+        return m_chunks.size();
+    }
+
+    // Keys in this set or in other
+    void unite(interval_map const& other)
+    {
+        combine(flips(), m_valBegin, other.flips(), other.m_valBegin, [](bool lhs, bool rhs) { return lhs || rhs; });
+    }
+
+    // Keys in both this set and other
+    void intersect(interval_map const& other)
+    {
+        combine(flips(), m_valBegin, other.flips(), other.m_valBegin, [](bool lhs, bool rhs) { return lhs && rhs; });
+    }
+
+    // Keys in this set but not in other
+    void subtract(interval_map const& other)
+    {
+        combine(flips(), m_valBegin, other.flips(), other.m_valBegin, [](bool lhs, bool rhs) { return lhs && !rhs; });
+    }
+
+    // Keys not in this set, the flips stay where they are
+    void complement()
+    {
+        m_valBegin = !m_valBegin;
+        for (chunk& bitmap : m_chunks)
+        {
+            for (uint64_t& bits : bitmap.bits)
+            {
+                bits = ~bits;
+            }
+        }
+    }
+
+private:
+    static constexpr bool s_values[2] = { false, true };
+
+    // Replace contents with op(a, b) where a and b are sets given by their flips
+    template<typename Op>
+    void combine(std::vector<K> const& a, bool aBegin, std::vector<K> const& b, bool bBegin, Op op)
+    {
+        std::vector<K> result;
+        const bool valBegin = merge(a, aBegin, b, bBegin, op, result);
+        m_flips.clear();
+        m_chunks.clear();
+        m_valBegin = valBegin;
+        encode(result, valBegin, valBegin, m_flips, m_chunks);
+    }
+
+    // Replace the chunks from the one of first to the one of last with op(in, inB),
+    // where b has flips in those chunks only and starts out of the set
+    template<typename Op>
+    void combine(K first, K last, std::vector<K> const& b, Op op)
+    {
+        const bool before = std::numeric_limits<K>::min() == first ? m_valBegin : contains(static_cast<K>(first - 1));
+        std::vector<K> result;
+        const bool valBegin = merge(flipsIn(first, last, before), before, b, false, op, result);
+
+        // State m_flips gives before the chunks and right after them
+        const bool toEnd = isLastChunk(last);
+        auto flipFirst = std::lower_bound(m_flips.begin(), m_flips.end(), first);
+        auto flipLast = toEnd ? m_flips.end() : std::upper_bound(flipFirst, m_flips.end(), chunkEnd(last));
+        bool masked = m_valBegin != bool((flipFirst - m_flips.begin()) & 1);
+        const bool after = m_valBegin != bool((flipLast - m_flips.begin()) & 1);
+
+        std::vector<K> flips;
+        std::vector<chunk> chunks;
+        if (masked != valBegin && (result.empty() || first < result.front()))
+        {
+            flips.push_back(first);
+            masked = valBegin;
+        }
+
+        masked = encode(result, valBegin, masked, flips, chunks);
+        if (!toEnd && masked != after)
+        {
+            if (!flips.empty() && flips.back() == chunkEnd(last))
+            {
+                flips.pop_back();
+            } else {
+                flips.push_back(chunkEnd(last));
+            }
+        }
+
+        m_flips.insert(m_flips.erase(flipFirst, flipLast), flips.begin(), flips.end());
+        auto chunkIt = std::lower_bound(m_chunks.begin(), m_chunks.end(), first, [](chunk const& lhs, K const& rhs) { return lhs.first < rhs; });
+        auto chunkLast = std::upper_bound(chunkIt, m_chunks.end(), last, [](K const& lhs, chunk const& rhs) { return lhs < rhs.first; });
+        m_chunks.insert(m_chunks.erase(chunkIt, chunkLast), chunks.begin(), chunks.end());
+    }
+
+    // Fill result with the flips of op(a, b) walking both once, returns the value before them
+    template<typename Op>
+    static bool merge(std::vector<K> const& a, bool aBegin, std::vector<K> const& b, bool bBegin, Op op, std::vector<K>& result)
+    {
+        result.reserve(a.size() + b.size());
+        bool inA = aBegin;
+        bool inB = bBegin;
+        const bool valBegin = op(inA, inB);
+        bool current = valBegin;
+        auto aIt = a.begin();
+        auto bIt = b.begin();
+        while (a.end() != aIt || b.end() != bIt)
+        {
+            K const* key;
+            if (b.end() == bIt || (a.end() != aIt && *aIt < *bIt))
+            {
+                key = &*aIt++;
+                inA = !inA;
+            } else if (a.end() == aIt || *bIt < *aIt) {
+                key = &*bIt++;
+                inB = !inB;
+            } else {
+                key = &*aIt++;
+                ++bIt;
+                inA = !inA;
+                inB = !inB;
+            }
+
+            if (op(inA, inB) != current)
+            {
+                result.push_back(*key);
+                current = !current;
+            }
+        }
+
+        return valBegin;
+    }
+
+    // Append flips to outFlips and outChunks, keeping those in chunks dense
+    // enough as bitmaps, the rest as they are. valBegin is the state before the
+    // flips and masked the one outFlips gives there, returns the one it gives after.
+    static bool encode(std::vector<K> const& flips, bool valBegin, bool masked, std::vector<K>& outFlips, std::vector<chunk>& outChunks)
+    {
+        // State after the first count flips
+        auto state = [valBegin](size_t count) { return valBegin != bool(count & 1); };
+        auto keep = [&](size_t index)
+        {
+            if (masked != state(index + 1))
+            {
+                outFlips.push_back(flips[index]);
+                masked = !masked;
+            }
+        };
+
+        for (size_t i = 0; i < flips.size();)
+        {
+            if constexpr (has_chunks)
+            {
+                const K first = chunkFirst(flips[i]);
+                size_t j = i;
+                while (flips.size() != j && chunkFirst(flips[j]) == first)
+                {
+                    j++;
+                }
+
+                if ((j - i) * sizeof(K) > sizeof(chunk))
+                {
+                    chunk bitmap;
+                    bitmap.first = first;
+                    size_t from = 0;
+                    for (size_t k = i; k < j; k++)
+                    {
+                        setBits(bitmap, from, offset(flips[k]), state(k));
+                        from = offset(flips[k]);
+                    }
+
+                    setBits(bitmap, from, chunkSize, state(j));
+
+                    outChunks.push_back(bitmap);
+
+                    // Flip back to what follows unless the next flip is right there
+                    if (!isLastChunk(first) && (flips.size() == j || chunkEnd(first) < flips[j]) && masked != state(j))
+                    {
+                        outFlips.push_back(chunkEnd(first));
+                        masked = !masked;
+                    }
+                } else {
+                    for (size_t k = i; k < j; k++)
+                    {
+                        keep(k);
+                    }
+                }
+
+                i = j;
+            } else {
+                keep(i++);
+            }
+        }
+
+        return masked;
+    }
+
+    // Keys in the chunks from the one of first to the one of last where
+    // membership flips, given the state before them
+    std::vector<K> flipsIn(K first, K last, bool actual) const
+    {
+        std::vector<K> result;
+        auto flipIt = std::upper_bound(m_flips.begin(), m_flips.end(), first);
+        auto chunkIt = std::lower_bound(m_chunks.begin(), m_chunks.end(), first, [](chunk const& lhs, K const& rhs) { return lhs.first < rhs; });
+
+        // State m_flips gives at key, which is right outside bitmaps
+        bool masked = m_valBegin != bool((flipIt - m_flips.begin()) & 1);
+        K key = first;
+        for (;;)
+        {
+            const bool bitmapNext = m_chunks.end() != chunkIt && !(last < chunkIt->first);
+            if (!bitmapNext || key < chunkIt->first)
+            {
+                if (masked != actual)
+                {
+                    result.push_back(key);
+                    actual = masked;
+                }
+
+                for (; m_flips.end() != flipIt && (bitmapNext ? *flipIt < chunkIt->first : !(last < chunkFirst(*flipIt))); ++flipIt)
+                {
+                    result.push_back(*flipIt);
+                    masked = !masked;
+                    actual = masked;
+                }
+            }
+
+            if (!bitmapNext)
+            {
+                return result;
+            }
+
+            for (size_t word = 0; word < chunkSize / 64; word++)
+            {
+                const uint64_t bits = chunkIt->bits[word];
+                for (uint64_t changes = bits ^ ((bits << 1) | (actual ? 1 : 0)); changes; changes &= changes - 1)
+                {
+                    result.push_back(static_cast<K>(static_cast<unsigned_key>(chunkIt->first) + word * 64 + lowestBit(changes)));
+                    actual = !actual;
+                }
+            }
+
+            if (isLastChunk(chunkIt->first))
+            {
+                return result;
+            }
+
+            key = chunkEnd(chunkIt->first);
+            for (; m_flips.end() != flipIt && !(key < *flipIt); ++flipIt)
+            {
+                masked = !masked;
+            }
+
+            ++chunkIt;
+        }
+    }
+
+    static K chunkFirst(K key)
+    {
+        return static_cast<K>(static_cast<unsigned_key>(key) & ~static_cast<unsigned_key>(chunkSize - 1));
+    }
+
+    static K chunkEnd(K first)
+    {
+        return static_cast<K>(static_cast<unsigned_key>(first) + chunkSize);
+    }
+
+    static bool isLastChunk(K first)
+    {
+        return chunkFirst(std::numeric_limits<K>::max()) == first;
+    }
+
+    static size_t offset(K key)
+    {
+        return static_cast<size_t>(static_cast<unsigned_key>(key) & (chunkSize - 1));
+    }
+
+    static bool testBit(chunk const& bitmap, size_t index)
+    {
+        return (bitmap.bits[index / 64] >> (index % 64)) & 1;
+    }
+
+    // Set or clear bits [from, to)
+    static void setBits(chunk& bitmap, size_t from, size_t to, bool val)
+    {
+        for (; from < to && from % 64; from++)
+        {
+            bitmap.bits[from / 64] = (bitmap.bits[from / 64] & ~(uint64_t(1) << (from % 64))) | (uint64_t(val) << (from % 64));
+        }
+
+        for (; from + 64 <= to; from += 64)
+        {
+            bitmap.bits[from / 64] = val ? ~uint64_t(0) : 0;
+        }
+
+        for (; from < to; from++)
+        {
+            bitmap.bits[from / 64] = (bitmap.bits[from / 64] & ~(uint64_t(1) << (from % 64))) | (uint64_t(val) << (from % 64));
+        }
+    }
+
+    static unsigned lowestBit(uint64_t word)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, word);
+        return static_cast<unsigned>(index);
+#else
+        return static_cast<unsigned>(__builtin_ctzll(word));
+#endif
+    }
+
+    // Whether the chunk of key, which has no bitmap, would be smaller as one
+    bool tooManyFlips(K const& key) const
+    {
+        const K first = chunkFirst(key);
+        auto begin = std::lower_bound(m_flips.begin(), m_flips.end(), first);
+        auto end = isLastChunk(first) ? m_flips.end() : std::lower_bound(begin, m_flips.end(), chunkEnd(first));
+        return (end - begin) * sizeof(K) > sizeof(chunk);
+    }
+};
+
+#endif // INTERVAL_MAP_INTERVAL_SET_HPP
\ No newline at end of file
@@ -0,0 +1,414 @@
+/* Copyright (C) 2024, Valkai-Nmeth Bla-rs */
+
+#ifndef INTERVAL_MAP_JOURNALED_INTERVAL_MAP_HPP
+#define INTERVAL_MAP_JOURNALED_INTERVAL_MAP_HPP
+
+#include "interval_map.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+// interval_map made durable by a write-ahead journal of the assign calls and
+// compact checkpoints of the canonical map. Assigns are journaled in groups, one
+// write and sync per group, and are durable once commit() returns. Recovery in
+// the constructor loads the latest checkpoint and replays only the journal after
+// it. Checkpoints alternate between two files, so a crash while writing one
+// leaves the other and the untruncated journal to recover from.
+// K and V are stored as raw bytes, so they must be trivially copyable.
+// Only changes the journal can record are public, contents() gives read-only
+// access to the underlying interval_map.
+template<typename K, typename V, typename Map = std::map<K, V>>
+class journaled_interval_map : protected interval_map<K, V, Map>
+{
+    static_assert(std::is_trivially_copyable_v<K> && std::is_trivially_copyable_v<V>, "journaled_interval_map stores K and V as raw bytes");
+
+public:
+    using change = typename interval_map<K, V, Map>::change;
+    using interval_map<K, V, Map>::operator[];
+    using interval_map<K, V, Map>::diff;
+
+    // The layout changes, the mapping, and so the journal, doesn't
+    using interval_map<K, V, Map>::compact;
+
+    // Recover the map kept in the files starting with path, or start a new one
+    // associating whole range of K with val. Journaled assigns are committed in
+    // groups of groupSize and a checkpoint is taken every checkpointInterval.
+    journaled_interval_map(V const& val, std::string const& path, size_t groupSize = 256, size_t checkpointInterval = 1 << 20)
+        : interval_map<K, V, Map>(val)
+        , m_path(path)
+        , m_groupSize(groupSize)
+        , m_checkpointInterval(checkpointInterval)
+    {
+        recover();
+    }
+
+    journaled_interval_map(journaled_interval_map const&) = delete;
+    journaled_interval_map& operator=(journaled_interval_map const&) = delete;
+
+    ~journaled_interval_map()
+    {
+        try
+        {
+            commit();
+        }
+        catch (std::exception const&)
+        {
+            // Uncommitted assigns are lost as in a crash
+        }
+
+        if (m_journal)
+        {
+            fclose(m_journal);
+        }
+    }
+
+    // Assign value val to interval [keyBegin, keyEnd) and journal it,
+    // durable after the next commit()
+    void assign(K const& keyBegin, K const& keyEnd, V const& val)
+    {
+        if (!(keyBegin < keyEnd))
+        {
+            return;
+        }
+
+        interval_map<K, V, Map>::assign(keyBegin, keyEnd, val);
+        journal(keyBegin, keyEnd, val);
+    }
+
+    // Reset [keyBegin, keyEnd) to the initial value and journal it as an assign
+    void reset(K const& keyBegin, K const& keyEnd)
+    {
+        if (!(keyBegin < keyEnd))
+        {
+            return;
+        }
+
+        interval_map<K, V, Map>::reset(keyBegin, keyEnd);
+        journal(keyBegin, keyEnd, this->m_valBegin);
+    }
+
+    // Write and sync the journaled assigns not yet durable, checkpointing
+    // once enough of them piled up in the journal
+    void commit()
+    {
+        if (m_pending.empty())
+        {
+            return;
+        }
+
+        writePending();
+        if (m_sinceCheckpoint >= m_checkpointInterval)
+        {
+            checkpoint();
+        }
+    }
+
+    // Write the whole map to a checkpoint and start an empty journal
+    void checkpoint()
+    {
+        writePending();
+
+        std::vector<char> buffer;
+        put(buffer, checkpointMagic);
+        put(buffer, m_sequence);
+        put(buffer, this->m_valBegin);
+        put(buffer, static_cast<uint64_t>(this->m_map.size()));
+        for (auto const& entry : this->m_map)
+        {
+            put(buffer, entry.first);
+            put(buffer, entry.second);
+        }
+
+        put(buffer, checksum(buffer.data(), buffer.size()));
+
+        // Overwrite the older of the two, the newer one stays valid meanwhile and
+        // stays the latest until this one is written and synced
+        const int slot = 1 - m_checkpointSlot;
+        FILE* pFile = open(checkpointPath(slot), "wb");
+        const bool written = fwrite(buffer.data(), 1, buffer.size(), pFile) == buffer.size() && sync(pFile);
+        if (0 != fclose(pFile) || !written)
+        {
+            throw std::runtime_error("failed to write checkpoint " + checkpointPath(slot));
+        }
+
+        m_checkpointSlot = slot;
+
+        // Only now the journal can go, it is not open if reopening it failed before
+        if (m_journal)
+        {
+            fclose(m_journal);
+            m_journal = nullptr;
+        }
+
+        m_journal = open(journalPath(), "wb");
+        m_sinceCheckpoint = 0;
+    }
+
+    // For cursors, overlays and the like reading the map
+    interval_map<K, V, Map> const& contents() const
+    {
+        return *this;
+    }
+
+    // Number of assigns so far, including the recovered ones
+    uint64_t sequence() const
+    {
+        return m_sequence;
+    }
+
+private:
+    // Write and sync the pending records to the journal
+    void writePending()
+    {
+        if (m_pending.empty())
+        {
+            return;
+        }
+
+        if (!m_journal)
+        {
+            throw std::runtime_error("journal " + journalPath() + " is not open");
+        }
+
+        if (fwrite(m_pending.data(), 1, m_pending.size(), m_journal) != m_pending.size() || !sync(m_journal))
+        {
+            throw std::runtime_error("failed to write journal " + journalPath());
+        }
+
+        m_pending.clear();
+        m_sinceCheckpoint += m_pendingCount;
+        m_pendingCount = 0;
+    }
+
+    // Append the record of an assign, committing full groups
+    void journal(K const& keyBegin, K const& keyEnd, V const& val)
+    {
+        const size_t recordBegin = m_pending.size();
+        put(m_pending, ++m_sequence);
+        put(m_pending, keyBegin);
+        put(m_pending, keyEnd);
+        put(m_pending, val);
+        put(m_pending, checksum(m_pending.data() + recordBegin, m_pending.size() - recordBegin));
+
+        if (++m_pendingCount >= m_groupSize)
+        {
+            commit();
+        }
+    }
+
+    static constexpr uint32_t checkpointMagic = 0x504d4349; // "ICMP"
+    static constexpr size_t recordSize = sizeof(uint64_t) + 2 * sizeof(K) + sizeof(V) + sizeof(uint32_t);
+
+    std::string journalPath() const
+    {
+        return m_path + ".journal";
+    }
+
+    std::string checkpointPath(int slot) const
+    {
+        return m_path + ".checkpoint" + std::to_string(slot);
+    }
+
+    static FILE* open(std::string const& path, const char* mode)
+    {
+        FILE* pFile = nullptr;
+#ifdef _MSC_VER
+        fopen_s(&pFile, path.c_str(), mode);
+#else
+        pFile = fopen(path.c_str(), mode);
+#endif
+        if (!pFile)
+        {
+            throw std::runtime_error("failed to open " + path);
+        }
+
+        return pFile;
+    }
+
+    // False if the data may not have reached the disk
+    static bool sync(FILE* pFile)
+    {
+        if (0 != fflush(pFile))
+        {
+            return false;
+        }
+
+#ifdef _WIN32
+        return 0 == _commit(_fileno(pFile));
+#else
+        return 0 == fsync(fileno(pFile));
+#endif
+    }
+
+    static std::vector<char> readFile(std::string const& path)
+    {
+        std::vector<char> result;
+        if (!std::filesystem::exists(path))
+        {
+            return result;
+        }
+
+        FILE* pFile = open(path, "rb");
+        char buffer[65536];
+        for (size_t read; (read = fread(buffer, 1, sizeof(buffer), pFile)) > 0;)
+        {
+            result.insert(result.end(), buffer, buffer + read);
+        }
+
+        fclose(pFile);
+        return result;
+    }
+
+    // FNV-1a
+    static uint32_t checksum(char const* pData, size_t size)
+    {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash = (hash ^ static_cast<unsigned char>(pData[i])) * 16777619u;
+        }
+
+        return hash;
+    }
+
+    template<typename T>
+    static void put(std::vector<char>& buffer, T const& value)
+    {
+        const size_t offset = buffer.size();
+        buffer.resize(offset + sizeof(T));
+        memcpy(buffer.data() + offset, &value, sizeof(T));
+    }
+
+    template<typename T>
+    static T get(char const*& pData)
+    {
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+        memcpy(&storage, pData, sizeof(T));
+        pData += sizeof(T);
+        return *reinterpret_cast<T*>(&storage);
+    }
+
+    // Read the sequence number of the checkpoint in slot and, if load is set, its
+    // contents into the map. False if the checkpoint is missing or damaged.
+    bool loadCheckpoint(int slot, uint64_t& sequence, bool load)
+    {
+        const std::vector<char> buffer = readFile(checkpointPath(slot));
+        const size_t headerSize = sizeof(uint32_t) + sizeof(uint64_t) + sizeof(V) + sizeof(uint64_t);
+        if (buffer.size() < headerSize + sizeof(uint32_t))
+        {
+            return false;
+        }
+
+        char const* pData = buffer.data() + buffer.size() - sizeof(uint32_t);
+        if (get<uint32_t>(pData) != checksum(buffer.data(), buffer.size() - sizeof(uint32_t)))
+        {
+            return false;
+        }
+
+        pData = buffer.data();
+        if (get<uint32_t>(pData) != checkpointMagic)
+        {
+            return false;
+        }
+
+        sequence = get<uint64_t>(pData);
+        const V valBegin = get<V>(pData);
+        const uint64_t count = get<uint64_t>(pData);
+        if (buffer.size() != headerSize + count * (sizeof(K) + sizeof(V)) + sizeof(uint32_t))
+        {
+            return false;
+        }
+
+        if (load)
+        {
+            this->m_valBegin = valBegin;
+            this->m_map.clear();
+            for (uint64_t i = 0; i < count; i++)
+            {
+                const K key = get<K>(pData);
+                this->m_map.emplace_hint(this->m_map.end(), key, get<V>(pData));
+            }
+        }
+
+        return true;
+    }
+
+    void recover()
+    {
+        // Latest valid checkpoint
+        uint64_t sequences[2] = {};
+        const bool valid[2] = { loadCheckpoint(0, sequences[0], false), loadCheckpoint(1, sequences[1], false) };
+        if (valid[0] || valid[1])
+        {
+            m_checkpointSlot = !valid[0] || (valid[1] && sequences[1] > sequences[0]) ? 1 : 0;
+            loadCheckpoint(m_checkpointSlot, m_sequence, true);
+        }
+
+        // Replay the journal after it up to the first torn or corrupt record
+        const std::vector<char> journal = readFile(journalPath());
+        size_t validSize = 0;
+        while (validSize + recordSize <= journal.size())
+        {
+            char const* pData = journal.data() + validSize;
+            const uint64_t sequence = get<uint64_t>(pData);
+            const K keyBegin = get<K>(pData);
+            const K keyEnd = get<K>(pData);
+            const V val = get<V>(pData);
+            if (get<uint32_t>(pData) != checksum(journal.data() + validSize, recordSize - sizeof(uint32_t)))
+            {
+                break;
+            }
+
+            // Records before the checkpoint are left over from before the journal was
+            // emptied. One after the next expected is missing records in between, as
+            // when the latest checkpoint was damaged after the journal was emptied.
+            if (sequence > m_sequence + 1)
+            {
+                throw std::runtime_error("journal " + journalPath() + " continues at " + std::to_string(sequence) + " instead of " + std::to_string(m_sequence + 1));
+            }
+
+            if (sequence > m_sequence)
+            {
+                interval_map<K, V, Map>::assign(keyBegin, keyEnd, val);
+                m_sequence = sequence;
+                m_sinceCheckpoint++;
+            }
+
+            validSize += recordSize;
+        }
+
+        // Cut off the torn tail so new records follow the valid ones
+        if (validSize < journal.size())
+        {
+            std::filesystem::resize_file(journalPath(), validSize);
+        }
+
+        m_journal = open(journalPath(), "ab");
+    }
+
+    std::string m_path;
+    size_t m_groupSize;
+    size_t m_checkpointInterval;
+
+    FILE* m_journal = nullptr;
+    int m_checkpointSlot = 1;
+    uint64_t m_sequence = 0;
+    size_t m_sinceCheckpoint = 0;
+
+    // Journal records of the group not yet committed
+    std::vector<char> m_pending;
+    size_t m_pendingCount = 0;
+};
+
+#endif // INTERVAL_MAP_JOURNALED_INTERVAL_MAP_HPP
\ No newline at end of file
@@ -1,39 +1,127 @@
 /* Copyright (C) 2024, Valkai-Nmeth Bla-rs */
 
 #include "interval_map.hpp"
+#include "buffered_interval_map.hpp"
+#include "columnar_interval_map.hpp"
+#include "treap_map.hpp"
+#include "small_map.hpp"
+#include "dense_storage.hpp"
+#include "radix_map.hpp"
+#include "rectangle_map.hpp"
+#include "frozen_interval_map.hpp"
+#include "frozen_query_engine.hpp"
+#include "packed_interval_map.hpp"
+#include "constexpr_interval_map.hpp"
+#include "versioned_interval_map.hpp"
+#include "journaled_interval_map.hpp"
+#include "concurrent_interval_map.hpp"
+#include "seqlock_interval_map.hpp"
+#include "interval_set.hpp"
+#include "interval_multimap.hpp"
+#include "pool_allocator.hpp"
 #include "TestTypes.hpp"
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <cassert>
 #include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
 #include <vector>
 
-// Unintrusive unit testable implementation with our test types
-class interval_map_ut : public interval_map<TestKey, TestValue>
+// Unintrusive unit testable implementation of an interval_map flavour
+template<typename IntervalMap>
+class interval_map_test : public IntervalMap
 {
 public:
-    interval_map_ut(TestValue const& val)
-        : interval_map<TestKey, TestValue>(val)
-    {}
+    using IntervalMap::IntervalMap;
 
     void AssertValidity()
     {
-        assert(m_map.empty() || !(m_map.begin()->second == m_valBegin));
+        assert(this->m_map.empty() || !(this->m_map.begin()->second == this->m_valBegin));
 
-        assert(m_map.empty() || m_map.rbegin()->second == m_valBegin);
+        assert(this->m_map.empty() || this->m_map.rbegin()->second == this->m_valBegin);
 
         // Check it's canonic
-        for (auto it = m_map.begin(); it != m_map.end(); it++)
+        for (auto it = this->m_map.begin(); it != this->m_map.end(); it++)
         {
-            assert(std::next(it) == m_map.end() || !(it->second == std::next(it)->second));
+            assert(std::next(it) == this->m_map.end() || !(it->second == std::next(it)->second));
         }
     }
 
     void clear()
     {
-        m_map.clear();
+        this->m_map.clear();
+    }
+
+    auto const& Entries() const
+    {
+        return this->m_map;
+    }
+};
+
+// With our test types
+using interval_map_ut = interval_map_test<interval_map<TestKey, TestValue>>;
+using buffered_interval_map_ut = interval_map_test<buffered_interval_map<TestKey, TestValue>>;
+using zipped_interval_map_ut = interval_map_test<interval_map<TestKey, std::pair<TestValue, TestValue>>>;
+using treap_interval_map_ut = interval_map_test<interval_map<TestKey, TestValue, treap_map<TestKey, TestValue>>>;
+using small_interval_map_ut = interval_map_test<interval_map<TestKey, TestValue, small_map<TestKey, TestValue, 4>>>;
+using pool_interval_map_ut = interval_map_test<interval_map<TestKey, TestValue, std::map<TestKey, TestValue, std::less<TestKey>, pool_allocator<std::pair<const TestKey, TestValue>>>>>;
+
+// Key type with few values, told to use one slot per value
+enum class Weekday { Monday, Tuesday, Wednesday, Thursday, Friday, Saturday, Sunday };
+
+template<>
+struct dense_key_traits<Weekday>
+{
+    static constexpr bool is_dense = true;
+    static constexpr size_t size = 7;
+
+    static size_t index(Weekday key)
+    {
+        return static_cast<size_t>(key);
     }
 };
 
+using radix_interval_map_ut = interval_map_test<interval_map<uint64_t, TestValue, radix_map<uint64_t, TestValue>>>;
+
+template<typename K>
+using dense_interval_map_ut = interval_map_test<interval_map<K, TestValue, dense_storage<K, TestValue>>>;
+
+template<typename K>
+using interval_set_ut = interval_map_test<interval_map<K, bool, set_storage<K>>>;
+
+// Lookup table built at compile time
+enum class CharClass { Other, Digit, Upper, Lower };
+
+constexpr auto charClasses = []()
+{
+    constexpr_interval_map<char32_t, CharClass, 8> table{ CharClass::Other };
+    table.assign(U'0', U'9' + 1, CharClass::Digit);
+    table.assign(U'A', U'Z' + 1, CharClass::Upper);
+    table.assign(U'a', U'z' + 1, CharClass::Lower);
+    return table;
+}();
+
+static_assert(charClasses[U'5'] == CharClass::Digit, "Built at compile time");
+static_assert(charClasses[U'Q'] == CharClass::Upper, "Built at compile time");
+static_assert(charClasses[U'z'] == CharClass::Lower, "Built at compile time");
+static_assert(charClasses[U'{'] == CharClass::Other, "Built at compile time");
+static_assert(charClasses.size() == 6, "Built at compile time");
+
 // Basic high resolution timer
 class HR_Timer
 {
@@ -311,46 +399,3309 @@ int main()
         assert(im[15] == 'A');
     }
 
-    /*/////////////////////////////////////////////////////////////////////////////////
-    std::cout << "Speed test" << std::endl;
+    std::cout << "Assign up to entry with same value" << std::endl;
     {
         interval_map_ut im{ 'A' };
-        HR_Timer timer;
-        long long avgTime=0;
+        im.assign(1, 3, 'B');
+        im.AssertValidity();
+        im.assign(2, 3, 'A');
+        im.AssertValidity();
+        assert(im[1] == 'B');
+        assert(im[2] == 'A');
+        assert(im[3] == 'A');
+    }
 
-        // Set srand() produce same inputs every time, since we want to time different
-        // implementations against eachother, not variable inputs
-        srand(0);
-        std::vector<std::tuple<int, int, char>> inputs;
+    std::cout << "Cursor on empty map" << std::endl;
+    {
+        interval_map_ut im{ 'A' };
+        interval_map_ut::cursor cur{ im };
+        assert(cur[-5] == 'A');
+        assert(cur[0] == 'A');
+        assert(cur[5] == 'A');
+    }
 
-        const int RAND_N = 1000;
-        for (int i = 0; i < RAND_N; i++)
+    std::cout << "Cursor walking forwards and backwards" << std::endl;
+    {
+        interval_map_ut im{ 'A' };
+        im.assign(2, 5, 'B');
+        im.assign(5, 8, 'C');
+        im.assign(10, 12, 'D');
+        im.AssertValidity();
+
+        interval_map_ut::cursor cur{ im };
+        for (int i = -3; i < 15; i++)
         {
-            int keyBegin = rand() % RAND_N;
-            int keyEnd = keyBegin + (rand() % RAND_N);
-            char c = 'A' + rand() % 26;
-            inputs.emplace_back(keyBegin, keyEnd, c);
+            assert(cur[i] == im[i]);
         }
 
-        const int MAX_ITERATIONS = 1000;
-        for (int i = 0; i < MAX_ITERATIONS; i++)
+        for (int i = 15; i > -3; i--)
         {
-            im.clear();
+            assert(cur[i] == im[i]);
+        }
 
-            timer.start();
-            for (auto tuple : inputs)
+        // Jumps far away fall back to a full search
+        assert(cur[11] == 'D');
+        assert(cur[-100] == 'A');
+        assert(cur[6] == 'C');
+        assert(cur[100] == 'A');
+        assert(cur[2] == 'B');
+    }
+
+    std::cout << "Cursor matches look-up on random streams" << std::endl;
+    {
+        interval_map_ut im{ 'A' };
+        srand(1);
+        for (int i = 0; i < 200; i++)
+        {
+            int keyBegin = rand() % 1000;
+            im.assign(keyBegin, keyBegin + rand() % 50, 'A' + rand() % 4);
+        }
+        im.AssertValidity();
+
+        interval_map_ut::cursor cur{ im };
+        int key = 0;
+        for (int i = 0; i < 5000; i++)
+        {
+            key = (i % 2) ? rand() % 1100 - 50 : key + rand() % 7 - 2;
+            assert(cur[key] == im[key]);
+        }
+    }
+
+    std::cout << "Buffered assigns wait for look-up" << std::endl;
+    {
+        buffered_interval_map_ut im{ 'A' };
+        im.assign(4, 20, 'B');
+        im.assign(15, 40, 'C');
+        im.assign(0, 5, 'A');
+        im.assign(7, 3, 'D');
+        assert(im.pending() == 3);
+        assert(im[3] == 'A');
+        assert(im.pending() == 0);
+        im.AssertValidity();
+        assert(im[4] == 'A');
+        assert(im[5] == 'B');
+        assert(im[14] == 'B');
+        assert(im[15] == 'C');
+        assert(im[39] == 'C');
+        assert(im[40] == 'A');
+    }
+
+    std::cout << "Buffered flush keeps untouched entries" << std::endl;
+    {
+        buffered_interval_map_ut im{ 'A' };
+        im.assign(0, 10, 'B');
+        im.assign(20, 30, 'C');
+        im.flush();
+        im.assign(5, 25, 'B');
+        im.assign(12, 14, 'D');
+        im.assign(25, 26, 'C');
+        im.flush();
+        im.AssertValidity();
+        assert(im[-1] == 'A');
+        assert(im[0] == 'B');
+        assert(im[11] == 'B');
+        assert(im[12] == 'D');
+        assert(im[14] == 'B');
+        assert(im[24] == 'B');
+        assert(im[25] == 'C');
+        assert(im[29] == 'C');
+        assert(im[30] == 'A');
+    }
+
+    std::cout << "Buffered matches assign on random bursts" << std::endl;
+    {
+        interval_map_ut reference{ 'A' };
+        buffered_interval_map_ut im{ 'A' };
+        srand(2);
+        for (int i = 0; i < 3000; i++)
+        {
+            int keyBegin = rand() % 200;
+            int keyEnd = keyBegin + rand() % 30 - 5;
+            char c = 'A' + rand() % 4;
+            reference.assign(keyBegin, keyEnd, c);
+            im.assign(keyBegin, keyEnd, c);
+
+            if (0 == rand() % 50)
             {
-                im.assign(std::get<0>(tuple), std::get<1>(tuple), std::get<2>(tuple));
+                im.flush();
+                im.AssertValidity();
+                for (int key = -5; key < 240; key++)
+                {
+                    assert(im[key] == reference[key]);
+                }
             }
-            timer.stop();
+        }
+    }
 
-            if (0 == i)
+    std::cout << "Buffered diff and cursor see pending assigns" << std::endl;
+    {
+        buffered_interval_map_ut im{ 'A' };
+        im.assign(0, 10, 'B');
+        interval_map_ut target{ 'A' };
+        target.assign(0, 10, 'B');
+        assert(im.diff(target).empty());
+        assert(im.pending() == 0);
+
+        im.assign(5, 15, 'C');
+        interval_map_ut::cursor cur(im.merged());
+        assert(im.pending() == 0);
+        assert(cur[4] == 'B' && cur[5] == 'C' && cur[14] == 'C' && cur[15] == 'A');
+    }
+
+    std::cout << "Buffered overlay and combine account for pending assigns" << std::endl;
+    {
+        buffered_interval_map_ut im{ 'A' };
+        im.assign(0, 10, 'B');
+        buffered_interval_map_ut overrides{ 'A' };
+        overrides.assign(5, 8, 'C');
+        im.overlay(overrides.merged());
+        assert(im[4] == 'B' && im[5] == 'C' && im[8] == 'B' && im[10] == 'A');
+        im.AssertValidity();
+
+        // Replaced contents aren't painted over by the assigns pending before
+        interval_map_ut a{ 'A' };
+        a.assign(0, 3, 'D');
+        im.assign(0, 20, 'E');
+        im.combine(a, overrides.merged(), [](TestValue const& valA, TestValue const& valB) { return valB == 'A' ? valA : valB; });
+        assert(im.pending() == 0);
+        assert(im[0] == 'D' && im[3] == 'A' && im[5] == 'C' && im[10] == 'A');
+        im.AssertValidity();
+    }
+
+    std::cout << "Buffered split and join account for pending assigns" << std::endl;
+    {
+        buffered_interval_map_ut im{ 'A' };
+        buffered_interval_map_ut right{ 'A' };
+        im.assign(0, 10, 'B');
+        right.assign(20, 30, 'C');
+        im.split(5, right);
+        assert(im.pending() == 0 && right.pending() == 0);
+        assert(im[4] == 'B' && im[5] == 'A' && right[4] == 'A' && right[7] == 'B' && right[20] == 'A');
+        im.AssertValidity();
+        right.AssertValidity();
+
+        right.assign(8, 12, 'D');
+        im.join(right);
+        assert(im[4] == 'B' && im[7] == 'B' && im[8] == 'D' && im[12] == 'A');
+        assert(right.pending() == 0 && right.Entries().empty());
+        im.AssertValidity();
+    }
+
+    std::cout << "Parallel replay matches assign" << std::endl;
+    {
+        interval_map_ut reference{ 'A' };
+        std::vector<buffered_interval_map_ut::entry> log;
+        srand(3);
+        for (int i = 0; i < 40000; i++)
+        {
+            int keyBegin = rand() % 5000;
+            int keyEnd = keyBegin + rand() % 60;
+            char c = 'A' + rand() % 5;
+            reference.assign(keyBegin, keyEnd, c);
+            log.emplace_back(keyBegin, keyEnd, c);
+        }
+        reference.AssertValidity();
+
+        for (unsigned threadCount : { 1, 2, 3, 8 })
+        {
+            buffered_interval_map_ut im{ 'A' };
+            im.assign(100, 200, 'Z');
+            im.replay(log.begin(), log.end(), threadCount);
+            im.AssertValidity();
+            for (int key = -5; key < 5100; key++)
+            {
+                assert(im[key] == reference[key]);
+            }
+
+            // Pending assigns are merged in parallel as well
+            for (auto const& entry : log)
+            {
+                im.assign(entry.keyBegin, entry.keyEnd, entry.val);
+            }
+            im.assign(0, 10, 'Z');
+            im.flush(threadCount);
+            im.AssertValidity();
+            assert(im[0] == 'Z');
+            for (int key = 10; key < 5100; key++)
+            {
+                assert(im[key] == reference[key]);
+            }
+        }
+    }
+
+    std::cout << "Overlay" << std::endl;
+    {
+        interval_map_ut base{ 'A' };
+        base.assign(0, 10, 'B');
+        base.assign(20, 30, 'C');
+
+        // 'X' is transparent in the overrides
+        interval_map_ut overrides{ 'X' };
+        overrides.assign(5, 25, 'D');
+        overrides.assign(8, 9, 'X');
+        overrides.assign(27, 28, 'C');
+        overrides.assign(40, 50, 'A');
+
+        base.overlay(overrides);
+        base.AssertValidity();
+        assert(base[-1] == 'A');
+        assert(base[4] == 'B');
+        assert(base[5] == 'D');
+        assert(base[8] == 'B');
+        assert(base[9] == 'D');
+        assert(base[24] == 'D');
+        assert(base[25] == 'C');
+        assert(base[29] == 'C');
+        assert(base[30] == 'A');
+        assert(base[40] == 'A');
+        assert(base[50] == 'A');
+
+        base.overlay(base);
+        base.AssertValidity();
+        assert(base[5] == 'D');
+    }
+
+    std::cout << "Combine and zip" << std::endl;
+    {
+        interval_map_ut a{ 'A' };
+        a.assign(0, 10, 'C');
+        interval_map_ut b{ 'B' };
+        b.assign(5, 15, 'A');
+        b.assign(20, 25, 'D');
+
+        interval_map_ut maximum{ 'A' };
+        maximum.combine(a, b, [](TestValue const& lhs, TestValue const& rhs) { return lhs.m_value < rhs.m_value ? rhs : lhs; });
+        maximum.AssertValidity();
+        assert(maximum[-1] == 'B');
+        assert(maximum[0] == 'C');
+        assert(maximum[9] == 'C');
+        assert(maximum[10] == 'A');
+        assert(maximum[14] == 'A');
+        assert(maximum[15] == 'B');
+        assert(maximum[20] == 'D');
+        assert(maximum[25] == 'B');
+
+        zipped_interval_map_ut zipped{ std::make_pair(TestValue('A'), TestValue('A')) };
+        zipped.zip(a, b);
+        zipped.AssertValidity();
+        assert(zipped[-1] == std::make_pair(TestValue('A'), TestValue('B')));
+        assert(zipped[5] == std::make_pair(TestValue('C'), TestValue('A')));
+        assert(zipped[12] == std::make_pair(TestValue('A'), TestValue('A')));
+        assert(zipped[22] == std::make_pair(TestValue('A'), TestValue('D')));
+    }
+
+    std::cout << "Overlay and combine match look-ups on random maps" << std::endl;
+    {
+        srand(4);
+        for (int i = 0; i < 50; i++)
+        {
+            interval_map_ut a{ 'A' };
+            interval_map_ut b{ TestValue('A' + rand() % 3) };
+            for (int j = 0; j < 30; j++)
+            {
+                int keyBegin = rand() % 100;
+                a.assign(keyBegin, keyBegin + rand() % 20, 'A' + rand() % 3);
+                keyBegin = rand() % 100;
+                b.assign(keyBegin, keyBegin + rand() % 20, 'A' + rand() % 3);
+            }
+
+            interval_map_ut combined{ 'A' };
+            combined.combine(a, b, [](TestValue const& lhs, TestValue const& rhs) { return TestValue(lhs.m_value ^ rhs.m_value); });
+            combined.AssertValidity();
+
+            interval_map_ut overlaid{ 'A' };
+            overlaid.combine(a, a, [](TestValue const& lhs, TestValue const&) { return lhs; });
+            overlaid.overlay(b);
+            overlaid.AssertValidity();
+
+            for (int key = -5; key < 130; key++)
+            {
+                assert(combined[key] == TestValue(a[key].m_value ^ b[key].m_value));
+                assert(overlaid[key] == (b[key] == b[-100] ? a[key] : b[key]));
+            }
+        }
+    }
+
+    std::cout << "Treap backed assign matches std::map backed" << std::endl;
+    {
+        interval_map_ut reference{ 'A' };
+        treap_interval_map_ut im{ 'A' };
+        srand(5);
+        for (int i = 0; i < 2000; i++)
+        {
+            int keyBegin = rand() % 300;
+            int keyEnd = keyBegin + rand() % 40 - 5;
+            char c = 'A' + rand() % 4;
+            reference.assign(keyBegin, keyEnd, c);
+            im.assign(keyBegin, keyEnd, c);
+            im.AssertValidity();
+        }
+
+        assert(im.Entries().size() == reference.Entries().size());
+        for (int key = -5; key < 350; key++)
+        {
+            assert(im[key] == reference[key]);
+        }
+    }
+
+    std::cout << "Split and join" << std::endl;
+    {
+        interval_map_ut im{ 'A' };
+        im.assign(0, 10, 'B');
+        im.assign(10, 20, 'C');
+
+        // Inside an interval
+        interval_map_ut right{ 'Z' };
+        im.split(5, right);
+        im.AssertValidity();
+        right.AssertValidity();
+        assert(im[4] == 'B');
+        assert(im[5] == 'A');
+        assert(right[4] == 'A');
+        assert(right[5] == 'B');
+        assert(right[10] == 'C');
+        assert(right[20] == 'A');
+
+        im.join(right);
+        im.AssertValidity();
+        right.AssertValidity();
+        assert(im[4] == 'B');
+        assert(im[5] == 'B');
+        assert(im[10] == 'C');
+        assert(im[20] == 'A');
+        assert(right[5] == 'A');
+
+        // At a boundary and outside of all entries
+        im.split(10, right);
+        assert(im[9] == 'B');
+        assert(im[10] == 'A');
+        assert(right[9] == 'A');
+        assert(right[10] == 'C');
+        im.join(right);
+        im.split(30, right);
+        im.AssertValidity();
+        right.AssertValidity();
+        assert(im[19] == 'C');
+        assert(right[19] == 'A');
+        im.join(right);
+        im.AssertValidity();
+        assert(im[9] == 'B');
+        assert(im[10] == 'C');
+    }
+
+    std::cout << "Split and join match look-ups on random maps" << std::endl;
+    {
+        srand(6);
+        for (int i = 0; i < 50; i++)
+        {
+            interval_map_ut im{ 'A' };
+            treap_interval_map_ut treapIm{ 'A' };
+            for (int j = 0; j < 40; j++)
+            {
+                int keyBegin = rand() % 100;
+                int keyEnd = keyBegin + rand() % 20;
+                char c = 'A' + rand() % 3;
+                im.assign(keyBegin, keyEnd, c);
+                treapIm.assign(keyBegin, keyEnd, c);
+            }
+
+            const int splitKey = rand() % 130 - 10;
+            interval_map_ut right{ 'A' };
+            treap_interval_map_ut treapRight{ 'A' };
+            interval_map_ut original{ 'A' };
+            original.overlay(im);
+            im.split(splitKey, right);
+            treapIm.split(splitKey, treapRight);
+            im.AssertValidity();
+            right.AssertValidity();
+            treapIm.AssertValidity();
+            treapRight.AssertValidity();
+            for (int key = -15; key < 130; key++)
+            {
+                assert(im[key] == (key < splitKey ? original[key] : TestValue('A')));
+                assert(right[key] == (key < splitKey ? TestValue('A') : original[key]));
+                assert(treapIm[key] == im[key]);
+                assert(treapRight[key] == right[key]);
+            }
+
+            im.join(right);
+            treapIm.join(treapRight);
+            im.AssertValidity();
+            treapIm.AssertValidity();
+            assert(right.Entries().empty());
+            assert(treapRight.Entries().empty());
+            for (int key = -15; key < 130; key++)
+            {
+                assert(im[key] == original[key]);
+                assert(treapIm[key] == original[key]);
+            }
+        }
+    }
+
+    std::cout << "Small map stays inline until it grows" << std::endl;
+    {
+        small_interval_map_ut im{ 'A' };
+        im.assign(0, 10, 'B');
+        im.assign(20, 30, 'C');
+        im.AssertValidity();
+        assert(!im.Entries().spilled());
+        assert(im[9] == 'B');
+        assert(im[20] == 'C');
+        assert(im[30] == 'A');
+
+        im.assign(40, 50, 'D');
+        im.AssertValidity();
+        assert(im.Entries().spilled());
+        assert(im[45] == 'D');
+
+        im.clear();
+        assert(!im.Entries().spilled());
+        assert(im[45] == 'A');
+    }
+
+    std::cout << "Small map backed operations match std::map backed" << std::endl;
+    {
+        srand(7);
+        for (int i = 0; i < 200; i++)
+        {
+            interval_map_ut reference{ 'A' };
+            small_interval_map_ut im{ 'A' };
+            const int assignCount = rand() % 8;
+            for (int j = 0; j < assignCount; j++)
+            {
+                int keyBegin = rand() % 50;
+                int keyEnd = keyBegin + rand() % 15;
+                char c = 'A' + rand() % 3;
+                reference.assign(keyBegin, keyEnd, c);
+                im.assign(keyBegin, keyEnd, c);
                 im.AssertValidity();
+            }
 
-            avgTime += timer.ms();
+            interval_map_ut overrides{ 'X' };
+            small_interval_map_ut smallOverrides{ 'X' };
+            int keyBegin = rand() % 50;
+            int keyEnd = keyBegin + rand() % 15;
+            overrides.assign(keyBegin, keyEnd, 'C');
+            smallOverrides.assign(keyBegin, keyEnd, 'C');
+
+            // Overrides backed by small_map as well
+            small_interval_map_ut smallOverlaid = im;
+            smallOverlaid.overlay(smallOverrides);
+            smallOverlaid.AssertValidity();
+
+            reference.overlay(overrides);
+            im.overlay(overrides);
+            im.AssertValidity();
+            for (int key = -5; key < 70; key++)
+            {
+                assert(smallOverlaid[key] == reference[key]);
+            }
+
+            small_interval_map_ut right{ 'A' };
+            const int splitKey = rand() % 60;
+            im.split(splitKey, right);
+            im.AssertValidity();
+            right.AssertValidity();
+            for (int key = -5; key < 70; key++)
+            {
+                assert((key < splitKey ? im[key] : right[key]) == reference[key]);
+            }
+
+            im.join(right);
+            im.AssertValidity();
+            for (int key = -5; key < 70; key++)
+            {
+                assert(im[key] == reference[key]);
+            }
         }
-        avgTime /= MAX_ITERATIONS;
+    }
 
-        std::cout<<"Finished in "<<avgTime<<"ms"<< std::endl;
+    std::cout << "Dense storage matches std::map backed" << std::endl;
+    {
+        srand(11);
+        interval_map_ut reference{ 'A' };
+        dense_interval_map_ut<uint8_t> im{ 'A' };
+        interval_map_ut signedReference{ 'A' };
+        dense_interval_map_ut<int8_t> signedIm{ 'A' };
+        for (int i = 0; i < 1000; i++)
+        {
+            int keyBegin = rand() % 256;
+            int keyEnd = keyBegin + rand() % 40;
+            keyEnd = keyEnd > 255 ? 255 : keyEnd;
+            char c = 'A' + rand() % 4;
+            reference.assign(keyBegin, keyEnd, c);
+            im.assign(static_cast<uint8_t>(keyBegin), static_cast<uint8_t>(keyEnd), c);
+            signedReference.assign(keyBegin - 128, keyEnd - 128, c);
+            signedIm.assign(static_cast<int8_t>(keyBegin - 128), static_cast<int8_t>(keyEnd - 128), c);
+
+            for (int key = 0; key < 256; key++)
+            {
+                assert(im[static_cast<uint8_t>(key)] == reference[key]);
+                assert(signedIm[static_cast<int8_t>(key - 128)] == signedReference[key - 128]);
+            }
+        }
+
+        // Empty and reversed intervals do nothing
+        im.assign(20, 20, 'X');
+        im.assign(30, 20, 'X');
+        assert(im[20] == reference[20]);
+        assert(im[25] == reference[25]);
+    }
+
+    std::cout << "Dense storage with enum keys" << std::endl;
+    {
+        dense_interval_map_ut<Weekday> im{ 'A' };
+        im.assign(Weekday::Tuesday, Weekday::Friday, 'B');
+        im.assign(Weekday::Thursday, Weekday::Sunday, 'C');
+        assert(im[Weekday::Monday] == 'A');
+        assert(im[Weekday::Tuesday] == 'B');
+        assert(im[Weekday::Wednesday] == 'B');
+        assert(im[Weekday::Thursday] == 'C');
+        assert(im[Weekday::Saturday] == 'C');
+        assert(im[Weekday::Sunday] == 'A');
+    }
+
+    std::cout << "Radix map backed operations match std::map backed" << std::endl;
+    {
+        // Clustered keys, including ones at the very ends of the key range
+        const uint64_t bases[] = { 0, 0x00007fff00000000ull, 0x123456789abc0000ull, 0xffffffffffffff00ull };
+
+        srand(13);
+        interval_map_test<interval_map<uint64_t, TestValue>> reference{ 'A' };
+        radix_interval_map_ut im{ 'A' };
+        for (int i = 0; i < 3000; i++)
+        {
+            const uint64_t base = bases[rand() % 4];
+            uint64_t keyBegin = base + rand() % 200;
+            uint64_t keyEnd = keyBegin + rand() % 50;
+            char c = 'A' + rand() % 3;
+            reference.assign(keyBegin, keyEnd, c);
+            im.assign(keyBegin, keyEnd, c);
+            im.AssertValidity();
+
+            assert(im.Entries().size() == reference.Entries().size());
+            assert(std::equal(im.Entries().begin(), im.Entries().end(), reference.Entries().begin()));
+
+            [[maybe_unused]] const uint64_t key = bases[rand() % 4] + rand() % 256;
+            assert(im[key] == reference[key]);
+        }
+
+        assert(im[0xffffffffffffffffull] == reference[0xffffffffffffffffull]);
+
+        radix_interval_map_ut right{ 'A' };
+        im.split(bases[2], right);
+        im.AssertValidity();
+        right.AssertValidity();
+        assert(im[bases[1] + 10] == reference[bases[1] + 10]);
+        assert(right[bases[2] + 10] == reference[bases[2] + 10]);
+        assert(im[bases[2] + 10] == 'A');
+
+        im.join(right);
+        im.AssertValidity();
+        assert(std::equal(im.Entries().begin(), im.Entries().end(), reference.Entries().begin(), reference.Entries().end()));
+
+        im.clear();
+        assert(im[bases[2] + 10] == 'A');
+    }
+
+    std::cout << "Frozen map matches the map it was made of" << std::endl;
+    {
+        srand(17);
+        for (int i = 0; i < 50; i++)
+        {
+            interval_map_test<interval_map<int, TestValue>> im{ 'A' };
+            interval_map_ut testKeyIm{ 'A' };
+            const int assignCount = rand() % 300;
+            for (int j = 0; j < assignCount; j++)
+            {
+                // Every few maps with keys skewed towards 0
+                int keyBegin = i % 3 ? rand() % 10000 - 5000 : (rand() % 100) * (rand() % 100) * (rand() % 100);
+                int keyEnd = keyBegin + rand() % 100;
+                char c = 'A' + rand() % 3;
+                im.assign(keyBegin, keyEnd, c);
+                testKeyIm.assign(keyBegin, keyEnd, c);
+            }
+
+            frozen_interval_map<TestKey, TestValue> testKeyFrozen(testKeyIm);
+            frozen_interval_map<int, TestValue> frozen(im);
+            frozen_interval_map<int, TestValue> indexed(im);
+            indexed.build_index(1 + rand() % 16);
+
+            for (int key = -6000; key < 1000000; key += (key < 10000 ? 1 : 997))
+            {
+                assert(frozen[key] == im[key]);
+                assert(indexed[key] == im[key]);
+                assert(testKeyFrozen[key] == im[key]);
+            }
+        }
+
+        // Uniform keys are found right where predicted
+        interval_map_test<interval_map<int, TestValue>> im{ 'A' };
+        for (int key = 0; key < 100000; key += 10)
+        {
+            im.assign(key, key + 5, 'B');
+        }
+
+        frozen_interval_map<int, TestValue> indexed(im);
+        indexed.build_index();
+        assert(indexed.indexed());
+        assert(indexed.index_error() <= 1);
+        assert(indexed[12] == 'B');
+        assert(indexed[15] == 'A');
+        assert(indexed[200000] == 'A');
+
+        // Keys thinning out exponentially crowd the first bucket and are not
+        // linear in it either
+        interval_map_test<interval_map<int, TestValue>> skewedIm{ 'A' };
+        for (int i = 0; i < 10000; i++)
+        {
+            const int key = static_cast<int>(std::exp(i * 0.002));
+            skewedIm.assign(key, key + 1, 'B' + i % 2);
+        }
+
+        frozen_interval_map<int, TestValue> skewed(skewedIm);
+        skewed.build_index();
+        for (int i = 0; i < 10000; i++)
+        {
+            [[maybe_unused]] const int key = static_cast<int>(std::exp(i * 0.002));
+            assert(skewed[key - 1] == skewedIm[key - 1]);
+            assert(skewed[key] == skewedIm[key]);
+            assert(skewed[key + 1] == skewedIm[key + 1]);
+        }
+
+        // Not worth indexing a handful of keys
+        interval_map_test<interval_map<int, TestValue>> tinyIm{ 'A' };
+        tinyIm.assign(10, 20, 'B');
+        frozen_interval_map<int, TestValue> tiny(tinyIm);
+        tiny.build_index(1);
+        assert(!tiny.indexed());
+        assert(tiny[15] == 'B');
+
+        // Floating point keys far outside the indexed range
+        interval_map_test<interval_map<double, TestValue>> doubleIm{ 'A' };
+        for (int i = 0; i < 1000; i++)
+        {
+            doubleIm.assign(i * 0.5, i * 0.5 + 0.25, 'B');
+        }
+
+        frozen_interval_map<double, TestValue> doubles(doubleIm);
+        doubles.build_index();
+        assert(doubles.indexed());
+        for ([[maybe_unused]] double key : { -1e300, -1.0, 0.1, 0.3, 250.0, 499.6, 1e300, std::numeric_limits<double>::infinity(), -std::numeric_limits<double>::infinity() })
+        {
+            assert(doubles[key] == doubleIm[key]);
+        }
+    }
+
+    std::cout << "Batch look-ups on frozen map" << std::endl;
+    {
+        srand(37);
+        interval_map_ut im{ 'A' };
+        for (int i = 0; i < 2000; i++)
+        {
+            int keyBegin = rand() % 100000;
+            im.assign(keyBegin, keyBegin + rand() % 200, 'A' + rand() % 26);
+        }
+
+        frozen_interval_map<TestKey, TestValue> frozen(im);
+        frozen_interval_map<TestKey, TestValue> empty(interval_map_ut{ 'E' });
+
+        std::vector<TestKey> keys;
+        for (int i = 0; i < 50000; i++)
+        {
+            keys.push_back(rand() % 110000 - 5000);
+        }
+
+        std::vector<TestKey> sortedKeys = keys;
+        std::sort(sortedKeys.begin(), sortedKeys.end());
+
+        std::vector<TestValue> out(keys.size(), 'X');
+        frozen.lookup(keys.data(), keys.size(), out.data());
+        for (size_t i = 0; i < keys.size(); i++)
+        {
+            assert(out[i] == im[keys[i]]);
+        }
+
+        frozen.lookup_sorted(sortedKeys.data(), sortedKeys.size(), out.data());
+        for (size_t i = 0; i < sortedKeys.size(); i++)
+        {
+            assert(out[i] == im[sortedKeys[i]]);
+        }
+
+        empty.lookup(keys.data(), 10, out.data());
+        empty.lookup_sorted(sortedKeys.data(), 10, out.data() + 10);
+        for (size_t i = 0; i < 20; i++)
+        {
+            assert(out[i] == 'E');
+        }
+
+        // Some chunks sorted, some not, several batches through the same pool
+        std::copy(sortedKeys.begin(), sortedKeys.begin() + 20000, keys.begin());
+        frozen_query_engine<TestKey, TestValue> engine(frozen, 4, 1000);
+        for (size_t count : { size_t(0), size_t(1), size_t(999), size_t(1001), keys.size() })
+        {
+            std::fill(out.begin(), out.end(), 'X');
+            engine.resolve(keys.data(), count, out.data());
+            for (size_t i = 0; i < keys.size(); i++)
+            {
+                assert(out[i] == (i < count ? im[keys[i]] : TestValue('X')));
+            }
+        }
+    }
+
+    std::cout << "Constexpr map matches interval_map" << std::endl;
+    {
+        srand(19);
+        for (int i = 0; i < 100; i++)
+        {
+            interval_map_test<interval_map<int, char>> reference{ 'A' };
+            constexpr_interval_map<int, char, 64> im{ 'A' };
+            for (int j = 0; j < 40; j++)
+            {
+                int keyBegin = rand() % 100;
+                int keyEnd = keyBegin + rand() % 20 - 2;
+                char c = 'A' + rand() % 3;
+                reference.assign(keyBegin, keyEnd, c);
+                im.assign(keyBegin, keyEnd, c);
+                assert(im.size() == reference.Entries().size());
+
+                for (int key = -2; key < 125; key++)
+                {
+                    assert(im[key] == reference[key]);
+                }
+            }
+        }
+    }
+
+    std::cout << "Constexpr map runs out of room" << std::endl;
+    {
+        constexpr_interval_map<int, char, 3> im{ 'A' };
+        im.assign(0, 10, 'B');
+        im.assign(10, 20, 'C');
+        assert(im.size() == 3);
+
+        [[maybe_unused]] bool thrown = false;
+        try
+        {
+            im.assign(30, 40, 'D');
+        }
+        catch (std::length_error const&)
+        {
+            thrown = true;
+        }
+
+        assert(thrown);
+        assert(im[35] == 'A');
+
+        // Overwriting boundaries needs no more room
+        im.assign(5, 20, 'D');
+        assert(im.size() == 3);
+        assert(im[4] == 'B');
+        assert(im[15] == 'D');
+        assert(im[20] == 'A');
+    }
+
+    std::cout << "Versioned map answers as of every version" << std::endl;
+    {
+        srand(23);
+        versioned_interval_map<TestKey, TestValue> im{ 'A' };
+        interval_map_ut reference{ 'A' };
+        std::vector<interval_map_ut> history(1, reference);
+        for (int i = 0; i < 300; i++)
+        {
+            int keyBegin = rand() % 200;
+            int keyEnd = keyBegin + rand() % 40 - 5;
+            char c = 'A' + rand() % 3;
+            reference.assign(keyBegin, keyEnd, c);
+            history.push_back(reference);
+            assert(im.assign(keyBegin, keyEnd, c) == history.size() - 1);
+        }
+
+        assert(im.version() == 300);
+        for (size_t version = 0; version < history.size(); version++)
+        {
+            for (int key = -5; key < 250; key++)
+            {
+                assert(im.at(key, version) == history[version][key]);
+            }
+        }
+
+        for (int key = -5; key < 250; key++)
+        {
+            assert(im[key] == reference[key]);
+        }
+    }
+
+    std::cout << "Journaled map recovers committed assigns" << std::endl;
+    {
+        const char* extensions[] = { ".journal", ".checkpoint0", ".checkpoint1" };
+        auto removeFiles = [&](std::string const& path)
+        {
+            for (auto extension : extensions)
+            {
+                std::filesystem::remove(path + extension);
+            }
+        };
+
+        removeFiles("journal_test");
+        removeFiles("journal_crash");
+
+        srand(29);
+        std::vector<interval_map_test<interval_map<int, char>>> history(1, interval_map_test<interval_map<int, char>>{ 'A' });
+        auto assignBoth = [&](auto& im)
+        {
+            int keyBegin = rand() % 100;
+            int keyEnd = keyBegin + 1 + rand() % 20;
+            char c = 'A' + rand() % 3;
+            history.push_back(history.back());
+            if (0 == rand() % 4)
+            {
+                // Journaled as an assign of the initial value
+                im.reset(keyBegin, keyEnd);
+                history.back().reset(keyBegin, keyEnd);
+            } else {
+                im.assign(keyBegin, keyEnd, c);
+                history.back().assign(keyBegin, keyEnd, c);
+            }
+        };
+
+        [[maybe_unused]] auto sameAs = [](auto const& im, auto const& reference)
+        {
+            return im.Entries().size() == reference.Entries().size() && std::equal(im.Entries().begin(), im.Entries().end(), reference.Entries().begin());
+        };
+
+        {
+            // Groups of 4, checkpoint after 12
+            interval_map_test<journaled_interval_map<int, char>> im('A', "journal_test", 4, 10);
+            for (int i = 0; i < 23; i++)
+            {
+                assignBoth(im);
+            }
+
+            // What a crash would leave: a checkpoint at 12, the journal up to 20
+            for (auto extension : extensions)
+            {
+                if (std::filesystem::exists(std::string("journal_test") + extension))
+                {
+                    std::filesystem::copy_file(std::string("journal_test") + extension, std::string("journal_crash") + extension);
+                }
+            }
+        }
+
+        {
+            interval_map_test<journaled_interval_map<int, char>> im('X', "journal_test");
+            assert(im.sequence() == 23);
+            assert(sameAs(im, history[23]));
+            im.AssertValidity();
+
+            // Read through contents(), the mutators which would skip the journal aren't reachable
+            interval_map<int, char>::cursor cur(im.contents());
+            for (int key = -5; key < 130; key++)
+            {
+                assert(cur[key] == history[23][key]);
+            }
+            assert(im.diff(history[23]).empty());
+        }
+
+        {
+            interval_map_test<journaled_interval_map<int, char>> im('X', "journal_crash");
+            assert(im.sequence() == 20);
+            assert(sameAs(im, history[20]));
+        }
+
+        // Half written record at the end of the journal
+        std::ofstream("journal_crash.journal", std::ios::binary | std::ios::app) << "torn";
+
+        history.erase(history.begin() + 21, history.end());
+        {
+            interval_map_test<journaled_interval_map<int, char>> im('X', "journal_crash");
+            assert(im.sequence() == 20);
+            assert(sameAs(im, history[20]));
+
+            // New records go right after the valid ones
+            assignBoth(im);
+            assignBoth(im);
+        }
+
+        {
+            interval_map_test<journaled_interval_map<int, char>> im('X', "journal_crash");
+            assert(im.sequence() == 22);
+            assert(sameAs(im, history[22]));
+
+            im.checkpoint();
+            assert(std::filesystem::file_size("journal_crash.journal") == 0);
+        }
+
+        {
+            interval_map_test<journaled_interval_map<int, char>> im('X', "journal_crash");
+            assert(im.sequence() == 22);
+            assert(sameAs(im, history[22]));
+        }
+
+        // A failed checkpoint leaves the valid one alone, the next goes to the same slot
+        removeFiles("journal_gap");
+        {
+            interval_map_test<journaled_interval_map<int, char>> im('A', "journal_gap", 1);
+            for (int i = 0; i < 3; i++)
+            {
+                assignBoth(im);
+            }
+            im.checkpoint();
+            assert(std::filesystem::exists("journal_gap.checkpoint0"));
+
+            std::filesystem::create_directory("journal_gap.checkpoint1");
+            [[maybe_unused]] bool failed = false;
+            try
+            {
+                im.checkpoint();
+            }
+            catch (std::runtime_error const&)
+            {
+                failed = true;
+            }
+            assert(failed);
+            std::filesystem::remove("journal_gap.checkpoint1");
+
+            im.checkpoint();
+            assert(std::filesystem::exists("journal_gap.checkpoint1"));
+
+            // Checkpoint at 5 in slot 0, the journal holds 6 and 7
+            assignBoth(im);
+            assignBoth(im);
+            im.checkpoint();
+            assignBoth(im);
+            assignBoth(im);
+        }
+
+        // Falling back to the checkpoint at 3 would skip 4 and 5
+        std::ofstream("journal_gap.checkpoint0", std::ios::binary | std::ios::trunc) << "damaged";
+        {
+            [[maybe_unused]] bool failed = false;
+            try
+            {
+                interval_map_test<journaled_interval_map<int, char>> im('A', "journal_gap");
+            }
+            catch (std::runtime_error const&)
+            {
+                failed = true;
+            }
+            assert(failed);
+        }
+
+        // A checkpoint committing enough assigns for the next one is taken once
+        removeFiles("journal_once");
+        {
+            interval_map_test<journaled_interval_map<int, char>> im('A', "journal_once", 10, 2);
+            im.assign(0, 10, 'B');
+            im.assign(5, 15, 'C');
+            im.assign(20, 30, 'D');
+            im.checkpoint();
+            assert(std::filesystem::exists("journal_once.checkpoint0"));
+            assert(!std::filesystem::exists("journal_once.checkpoint1"));
+
+            // The journal failing to reopen leaves it closed until the next checkpoint
+            std::filesystem::remove("journal_once.journal");
+            std::filesystem::create_directory("journal_once.journal");
+            [[maybe_unused]] bool failed = false;
+            try
+            {
+                im.checkpoint();
+            }
+            catch (std::runtime_error const&)
+            {
+                failed = true;
+            }
+            assert(failed);
+            std::filesystem::remove("journal_once.journal");
+
+            im.checkpoint();
+            im.assign(40, 50, 'E');
+        }
+
+        {
+            interval_map_test<journaled_interval_map<int, char>> im('X', "journal_once");
+            assert(im.sequence() == 4);
+            assert(im[0] == 'B' && im[5] == 'C' && im[20] == 'D' && im[40] == 'E' && im[50] == 'A');
+        }
+
+        removeFiles("journal_test");
+        removeFiles("journal_crash");
+        removeFiles("journal_gap");
+        removeFiles("journal_once");
+    }
+
+    std::cout << "Diff turns one map into the other" << std::endl;
+    {
+        srand(31);
+        for (int i = 0; i < 300; i++)
+        {
+            interval_map_ut a{ 'A' };
+            treap_interval_map_ut b{ 'A' };
+            for (int j = 0; j < 10; j++)
+            {
+                int keyBegin = rand() % 100;
+                int keyEnd = keyBegin + rand() % 30;
+                a.assign(keyBegin, keyEnd, 'A' + rand() % 3);
+                if (rand() % 2)
+                {
+                    b.assign(keyBegin, keyEnd, 'A' + rand() % 3);
+                }
+            }
+
+            const auto changes = a.diff(b);
+            for (auto const& change : changes)
+            {
+                // Only keys that differ are written, with target's value
+                for (int key = change.keyBegin.m_value; key < change.keyEnd.m_value; key++)
+                {
+                    assert(!(a[key] == b[key]));
+                    assert(b[key] == change.val);
+                }
+            }
+
+            for (auto const& change : changes)
+            {
+                a.assign(change.keyBegin, change.keyEnd, change.val);
+            }
+
+            a.AssertValidity();
+            for (int key = -5; key < 140; key++)
+            {
+                assert(a[key] == b[key]);
+            }
+
+            assert(a.diff(b).empty());
+        }
+    }
+
+    std::cout << "Transparent comparator takes other key types" << std::endl;
+    {
+        using string_interval_map = interval_map<std::string, char, std::map<std::string, char, std::less<>>>;
+        interval_map_test<string_interval_map> im{ 'A' };
+        im.assign(std::string_view("b"), std::string_view("d"), 'B');
+        im.assign("c", "e", 'C');
+        im.assign(std::string("x"), std::string("y"), 'X');
+        im.AssertValidity();
+
+        assert(im["a"] == 'A');
+        assert(im[std::string_view("b")] == 'B');
+        assert(im[std::string_view("bzz")] == 'B');
+        assert(im["c"] == 'C');
+        assert(im[std::string("dz")] == 'C');
+        assert(im["e"] == 'A');
+        assert(im["x"] == 'X');
+
+        string_interval_map::cursor cursor{ im };
+        assert(cursor["a"] == 'A');
+        assert(cursor[std::string_view("cq")] == 'C');
+        assert(cursor["xx"] == 'X');
+    }
+
+    {
+        using counted_interval_map = interval_map<CountedKey, TestValue, std::map<CountedKey, TestValue, std::less<>>>;
+        interval_map_test<counted_interval_map> im{ 'A' };
+        im.assign(10, 20, 'B');
+        im.assign(15, 30, 'C');
+        im.AssertValidity();
+
+        // Neither look-ups nor assigns within existing boundaries make keys
+        CountedKey::s_constructed = 0;
+        for (int key = 0; key < 40; key++)
+        {
+            assert(im[key] == (key < 10 ? 'A' : key < 15 ? 'B' : key < 30 ? 'C' : 'A'));
+        }
+
+        counted_interval_map::cursor cursor{ im };
+        for (int key = 0; key < 40; key++)
+        {
+            assert(cursor[key] == im[key]);
+        }
+
+        im.assign(10, 30, 'A');
+        assert(im.Entries().empty());
+        assert(0 == CountedKey::s_constructed);
+
+        im.assign(5, 6, 'D');
+        assert(im[5] == 'D');
+        assert(2 == CountedKey::s_constructed);
+    }
+
+    std::cout << "Concurrent map under contention" << std::endl;
+    {
+        auto assertCanonical = [](std::vector<std::pair<int, char>> const& boundaries, char valBegin)
+        {
+            [[maybe_unused]] char current = valBegin;
+            for (size_t i = 0; i < boundaries.size(); i++)
+            {
+                assert(boundaries[i].second != current);
+                assert(0 == i || boundaries[i - 1].first < boundaries[i].first);
+                current = boundaries[i].second;
+            }
+        };
+
+        std::vector<int> splits;
+        for (int split = 500; split < 4000; split += 500)
+        {
+            splits.push_back(split);
+        }
+
+        // Writers of their own quarter of the keys, crossing shards often
+        concurrent_interval_map<int, char> im('A', splits);
+        assert(im.shard_count() == 8);
+        std::vector<std::thread> threads;
+        std::vector<std::vector<char>> expected(4, std::vector<char>(1000, 'A'));
+        for (int t = 0; t < 4; t++)
+        {
+            threads.emplace_back([&im, &expected, t]()
+            {
+                uint32_t random = 2463534242u + t;
+                for (int i = 0; i < 3000; i++)
+                {
+                    random ^= random << 13;
+                    random ^= random >> 17;
+                    random ^= random << 5;
+                    const int keyBegin = random % 1000;
+                    const int keyEnd = std::min<int>(1000, keyBegin + 1 + (random >> 10) % 300);
+                    const char val = 'A' + (random >> 20) % 4;
+                    im.assign(t * 1000 + keyBegin, t * 1000 + keyEnd, val);
+                    std::fill(expected[t].begin() + keyBegin, expected[t].begin() + keyEnd, val);
+                    assert(im[t * 1000 + keyBegin] == val);
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        for (int key = -10; key < 4010; key++)
+        {
+            assert(im[key] == (key < 0 || key >= 4000 ? 'A' : expected[key / 1000][key % 1000]));
+        }
+
+        assertCanonical(im.boundaries(), 'A');
+
+        // Assigns over all shards are never seen half applied
+        concurrent_interval_map<int, char> whole('A', splits);
+        std::atomic<int> writersDone{ 0 };
+        threads.clear();
+        for (int t = 0; t < 2; t++)
+        {
+            threads.emplace_back([&whole, &writersDone, t]()
+            {
+                for (int i = 0; i < 2000; i++)
+                {
+                    whole.assign(0, 4000, 'A' + (t * 2 + i) % 4);
+                }
+
+                writersDone++;
+            });
+        }
+
+        threads.emplace_back([&whole, &writersDone, &assertCanonical]()
+        {
+            while (writersDone < 2)
+            {
+                const auto boundaries = whole.boundaries();
+                assertCanonical(boundaries, 'A');
+                assert(boundaries.empty() || (2 == boundaries.size() && 0 == boundaries[0].first && 4000 == boundaries[1].first));
+            }
+        });
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        const auto boundaries = whole.boundaries();
+        assertCanonical(boundaries, 'A');
+        for (int key = 0; key < 4000; key += 100)
+        {
+            assert(whole[key] == whole[0]);
+        }
+
+        // An assign over several shards throwing midway leaves them unlocked
+        struct throwing_value
+        {
+            throwing_value(char value, bool const* pThrow)
+                : value(value)
+                , pThrow(pThrow)
+            {}
+
+            throwing_value(throwing_value const& rhs)
+                : value(rhs.value)
+                , pThrow(rhs.pThrow)
+            {
+                if (*pThrow)
+                {
+                    throw std::runtime_error("copy failed");
+                }
+            }
+
+            throwing_value& operator=(throwing_value const&) = default;
+
+            bool operator==(throwing_value const& rhs) const
+            {
+                return value == rhs.value;
+            }
+
+            char value;
+            bool const* pThrow;
+        };
+
+        bool throwCopies = false;
+        concurrent_interval_map<int, throwing_value> throwing(throwing_value('A', &throwCopies), splits);
+        throwCopies = true;
+        [[maybe_unused]] bool thrown = false;
+        try
+        {
+            throwing.assign(100, 2100, throwing_value('B', &throwCopies));
+        }
+        catch (std::runtime_error const&)
+        {
+            thrown = true;
+        }
+
+        assert(thrown);
+        throwCopies = false;
+        throwing.assign(100, 2100, throwing_value('C', &throwCopies));
+        assert('C' == throwing[1000].value && 'A' == throwing[2100].value);
+    }
+
+    std::cout << "Seqlock map readers see whole assigns" << std::endl;
+    {
+        srand(42);
+        seqlock_interval_map<int, char> im('A', 2);
+        interval_map_test<interval_map<int, char>> reference{ 'A' };
+        for (int i = 0; i < 3000; i++)
+        {
+            int keyBegin = rand() % 500;
+            int keyEnd = keyBegin + rand() % 60;
+            char val = 'A' + rand() % 4;
+            im.assign(keyBegin, keyEnd, val);
+            reference.assign(keyBegin, keyEnd, val);
+            assert(im.size() == reference.Entries().size());
+            for (int key = keyBegin - 2; key < keyEnd + 2; key++)
+            {
+                assert(im[key] == reference[key]);
+            }
+        }
+
+        for (int key = -10; key < 600; key++)
+        {
+            assert(im[key] == reference[key]);
+        }
+    }
+
+    {
+        // The writer grows a prefix of B while shifting the arrays with noise
+        // below it, readers never see a B go back or a value from elsewhere
+        seqlock_interval_map<int, char> im('A', 2);
+        std::atomic<bool> writing{ true };
+        std::thread reader([&im, &writing]()
+        {
+            std::vector<bool> seenB(1000, false);
+            uint32_t random = 2463534242u;
+            while (writing)
+            {
+                random ^= random << 13;
+                random ^= random >> 17;
+                random ^= random << 5;
+                const int key = random % 1000;
+                [[maybe_unused]] const char noise = im[key];
+                assert('A' == noise || 'C' == noise || 'D' == noise);
+
+                const char prefix = im[5000 + key];
+                assert('B' == prefix || ('A' == prefix && !seenB[key]));
+                seenB[key] = 'B' == prefix;
+            }
+        });
+
+        uint32_t random = 88675123u;
+        for (int i = 1; i <= 1000; i++)
+        {
+            for (int j = 0; j < 20; j++)
+            {
+                random ^= random << 13;
+                random ^= random >> 17;
+                random ^= random << 5;
+                const int keyBegin = random % 1000;
+                im.assign(keyBegin, std::min<int>(1000, keyBegin + 1 + (random >> 12) % 20), (random >> 24) % 3 ? 'C' : 'D');
+            }
+
+            im.assign(5000, 5000 + i, 'B');
+        }
+
+        writing = false;
+        reader.join();
+        assert(im[5999] == 'B' && im[6000] == 'A');
+    }
+
+    std::cout << "Interval set with bitmap chunks" << std::endl;
+    {
+        // Keys from -12000 to 12000, short ranges make some chunks bitmaps.
+        // The first key is left as it was, like all the keys out of the range.
+        const int LOW = -12000;
+        const int HIGH = 12000;
+        auto randomSet = [&](interval_set_ut<int>& set, std::vector<bool>& reference, int assigns, int maxLength)
+        {
+            for (int i = 0; i < assigns; i++)
+            {
+                int keyBegin = LOW + 1 + rand() % (HIGH - LOW - 1);
+                int keyEnd = std::min(HIGH, keyBegin + rand() % maxLength);
+                bool val = rand() % 2;
+                set.assign(keyBegin, keyEnd, val);
+                std::fill(reference.begin() + (keyBegin - LOW), reference.begin() + (keyEnd - LOW), val);
+            }
+        };
+
+        auto assertSame = [&](interval_set_ut<int> const& set, std::vector<bool> const& reference)
+        {
+            for (int key = LOW - 5; key < HIGH + 5; key++)
+            {
+                [[maybe_unused]] const bool expected = key < LOW || key >= HIGH ? reference.front() : reference[key - LOW];
+                assert(set[key] == expected);
+            }
+
+            const auto flips = set.flips();
+            for (size_t i = 0; i < flips.size(); i++)
+            {
+                assert(0 == i || flips[i - 1] < flips[i]);
+                assert(set[flips[i]] != set[flips[i] - 1]);
+            }
+        };
+
+        srand(43);
+        for (int round = 0; round < 20; round++)
+        {
+            interval_set_ut<int> a{ false };
+            interval_set_ut<int> b{ false };
+            std::vector<bool> refA(HIGH - LOW, false);
+            std::vector<bool> refB(HIGH - LOW, false);
+            randomSet(a, refA, 2000, round % 2 ? 8 : 2000);
+            randomSet(b, refB, 2000, round % 3 ? 8 : 2000);
+            assert(0 == round % 2 || a.bitmap_count() > 0);
+            assertSame(a, refA);
+            assertSame(b, refB);
+
+            // Same set whatever the encoding
+            interval_set_ut<int> copy{ false };
+            copy.unite(a);
+            assert(copy.flips() == a.flips());
+
+            std::vector<bool> expected(HIGH - LOW);
+            interval_set_ut<int> result{ false };
+            result.unite(a);
+            result.unite(b);
+            std::transform(refA.begin(), refA.end(), refB.begin(), expected.begin(), [](bool lhs, bool rhs) { return lhs || rhs; });
+            assertSame(result, expected);
+
+            result.intersect(a);
+            assertSame(result, refA);
+            result.intersect(b);
+            std::transform(refA.begin(), refA.end(), refB.begin(), expected.begin(), [](bool lhs, bool rhs) { return lhs && rhs; });
+            assertSame(result, expected);
+
+            result.complement();
+            std::transform(expected.begin(), expected.end(), expected.begin(), [](bool in) { return !in; });
+            assertSame(result, expected);
+
+            a.subtract(b);
+            std::transform(refA.begin(), refA.end(), refB.begin(), refA.begin(), [](bool lhs, bool rhs) { return lhs && !rhs; });
+            assertSame(a, refA);
+
+            // Keep assigning into the encoded set
+            randomSet(a, refA, 500, round % 2 ? 8 : 500);
+            assertSame(a, refA);
+
+            std::vector<int> keys;
+            for (int i = 0; i < 3000; i++)
+            {
+                keys.push_back(LOW - 5 + rand() % (HIGH - LOW + 10));
+            }
+
+            if (round % 2)
+            {
+                std::sort(keys.begin(), keys.end());
+            }
+
+            std::unique_ptr<bool[]> out(new bool[keys.size()]);
+            a.contains(keys.data(), keys.size(), out.get());
+            for (size_t i = 0; i < keys.size(); i++)
+            {
+                assert(out[i] == a[keys[i]]);
+            }
+        }
+
+        interval_set_ut<uint32_t> sparse{ false };
+        for (uint32_t key = 0; key < 100000; key += 1000)
+        {
+            sparse.assign(key, key + 10, true);
+        }
+        assert(0 == sparse.bitmap_count());
+        assert(200 == sparse.flips().size());
+
+        // Every other key near the end of the key range
+        interval_set_ut<uint32_t> dense{ true };
+        const uint32_t MAX = std::numeric_limits<uint32_t>::max();
+        for (uint32_t key = MAX - 6000; key < MAX; key += 2)
+        {
+            dense.assign(key, key + 1, false);
+        }
+
+        interval_set_ut<uint32_t> copy{ false };
+        copy.unite(dense);
+        assert(copy.bitmap_count() == 2);
+        for (uint32_t key = MAX - 6010; key != 0; key++)
+        {
+            [[maybe_unused]] const bool expected = key < MAX - 6000 || key == MAX || (key - (MAX - 6000)) % 2;
+            assert(dense[key] == expected);
+            assert(copy[key] == expected);
+        }
+        assert(copy.flips() == dense.flips());
+
+        copy.complement();
+        assert(!copy[0] && !copy[MAX - 6001] && copy[MAX - 6000] && !copy[MAX]);
+    }
+
+    std::cout << "Interval set assigns across bitmaps" << std::endl;
+    {
+        // Every third key built up in ascending order, then ranges over several bitmaps
+        const uint32_t COUNT = 40000;
+        interval_set_ut<uint32_t> set{ false };
+        std::vector<bool> reference(COUNT, false);
+        for (uint32_t key = 0; key < COUNT; key += 3)
+        {
+            set.assign(key, key + 1, true);
+            reference[key] = true;
+        }
+        assert(set.bitmap_count() >= COUNT / 4096);
+
+        auto assertSame = [&]()
+        {
+            for (uint32_t key = 0; key < COUNT + 10; key++)
+            {
+                assert(set[key] == (key < COUNT && reference[key]));
+            }
+
+            interval_set_ut<uint32_t> copy{ false };
+            copy.unite(set);
+            assert(copy.flips() == set.flips());
+        };
+        assertSame();
+
+        srand(47);
+        for (int i = 0; i < 200; i++)
+        {
+            const uint32_t keyBegin = rand() % COUNT;
+            const uint32_t keyEnd = std::min(COUNT, keyBegin + 1 + rand() % 10000);
+            const bool val = rand() % 2;
+            set.assign(keyBegin, keyEnd, val);
+            std::fill(reference.begin() + keyBegin, reference.begin() + keyEnd, val);
+            if (0 == i % 20)
+            {
+                assertSame();
+            }
+        }
+        assertSame();
+
+        // Bitmaps in the last chunk, then a range ending in it
+        const uint32_t MAX = std::numeric_limits<uint32_t>::max();
+        interval_set_ut<uint32_t> top{ false };
+        for (uint32_t key = MAX - 9000; key < MAX; key += 2)
+        {
+            top.assign(key, key + 1, true);
+        }
+        top.assign(MAX - 8000, MAX - 10, false);
+        top.assign(MAX - 3, MAX, true);
+        for (uint32_t key = MAX - 9010; key != 0; key++)
+        {
+            [[maybe_unused]] const bool expected = key >= MAX - 3 ? key != MAX : key >= MAX - 9000 && (key < MAX - 8000 || key >= MAX - 10) && 0 == (key - (MAX - 9000)) % 2;
+            assert(top[key] == expected);
+        }
+    }
+
+    std::cout << "Packed map matches the map it was built from" << std::endl;
+    {
+        srand(44);
+        for (int round = 0; round < 40; round++)
+        {
+            // Tightly clustered or spread over all 64 bits
+            const uint64_t spread = round % 2 ? 1000 : ~uint64_t(0) / 4096;
+            radix_interval_map_ut im{ 'A' };
+            const int assigns = rand() % 2000;
+            for (int i = 0; i < assigns; i++)
+            {
+                uint64_t keyBegin = (static_cast<uint64_t>(rand()) * RAND_MAX + rand()) % 4096 * spread;
+                im.assign(keyBegin, keyBegin + 1 + rand() % spread, 'A' + rand() % 26);
+            }
+
+            packed_interval_map<uint64_t, TestValue> packed(im);
+            assert(packed.size() == im.Entries().size());
+            for ([[maybe_unused]] auto const& entry : im.Entries())
+            {
+                assert(packed[entry.first] == entry.second);
+                assert(packed[entry.first - 1] == im[entry.first - 1]);
+                assert(packed[entry.first + 1] == im[entry.first + 1]);
+            }
+
+            for (int i = 0; i < 1000; i++)
+            {
+                [[maybe_unused]] const uint64_t key = (static_cast<uint64_t>(rand()) * RAND_MAX + rand()) % 4097 * spread;
+                assert(packed[key] == im[key]);
+            }
+
+            assert(packed[0] == im[0]);
+            assert(packed[~uint64_t(0)] == im[~uint64_t(0)]);
+        }
+
+        interval_map_test<interval_map<uint16_t, char>> small{ 'A' };
+        small.assign(0, 1, 'B');
+        small.assign(65534, 65535, 'C');
+        packed_interval_map<uint16_t, char> packed(small);
+        assert(packed[0] == 'B' && packed[1] == 'A' && packed[65534] == 'C' && packed[65535] == 'A');
+
+        // Keys 16 apart need 11 bits each instead of 64
+        radix_interval_map_ut dense{ 'A' };
+        for (uint64_t key = 0; key < 160000; key += 16)
+        {
+            dense.assign(key, key + 8, 'B');
+        }
+
+        packed_interval_map<uint64_t, TestValue> packedDense(dense);
+        assert(packedDense.memory_bytes() < packedDense.size() * (sizeof(uint64_t) + sizeof(TestValue)) / 3);
+
+        // Last block holding a single key, which packs to no words
+        for (size_t count : { size_t(1), packedDense.blockSize + 1, 3 * packedDense.blockSize + 1 })
+        {
+            struct boundaries : interval_map_test<interval_map<uint64_t, char>>
+            {
+                boundaries(size_t count)
+                    : interval_map_test<interval_map<uint64_t, char>>('A')
+                {
+                    for (size_t i = 0; i < count; i++)
+                    {
+                        this->m_map.emplace(10 + 3 * i, 'B' + i % 2);
+                    }
+                }
+            } im(count);
+
+            packed_interval_map<uint64_t, char> packedOdd(im);
+            assert(packedOdd.size() == count);
+            for (uint64_t key = 0; key < 20 + 3 * count; key++)
+            {
+                assert(packedOdd[key] == im[key]);
+            }
+            assert(packedOdd[~uint64_t(0)] == im[~uint64_t(0)]);
+        }
+    }
+
+    std::cout << "Columnar map shares boundaries between columns" << std::endl;
+    {
+        using columns = std::tuple<TestValue, char, int>;
+        auto run = [](auto& im)
+        {
+            interval_map_ut owner{ 'A' };
+            interval_map_test<interval_map<TestKey, char>> tier{ 'x' };
+            interval_map_test<interval_map<TestKey, int>> region{ 0 };
+            for (int i = 0; i < 3000; i++)
+            {
+                int keyBegin = rand() % 200;
+                int keyEnd = keyBegin + rand() % 40;
+                switch (rand() % 4)
+                {
+                case 0:
+                {
+                    TestValue val('A' + rand() % 3);
+                    im.template assign_column<0>(keyBegin, keyEnd, val);
+                    owner.assign(keyBegin, keyEnd, val);
+                    break;
+                }
+                case 1:
+                {
+                    char val = 'x' + rand() % 3;
+                    im.template assign_column<1>(keyBegin, keyEnd, val);
+                    tier.assign(keyBegin, keyEnd, val);
+                    break;
+                }
+                case 2:
+                {
+                    int val = rand() % 3;
+                    im.template assign_column<2>(keyBegin, keyEnd, val);
+                    region.assign(keyBegin, keyEnd, val);
+                    assert(im.template column<2>(keyBegin) == region[keyBegin] || !(keyBegin < keyEnd));
+                    break;
+                }
+                default:
+                {
+                    columns val('A' + rand() % 3, 'x' + rand() % 3, rand() % 3);
+                    im.assign(keyBegin, keyEnd, val);
+                    owner.assign(keyBegin, keyEnd, std::get<0>(val));
+                    tier.assign(keyBegin, keyEnd, std::get<1>(val));
+                    region.assign(keyBegin, keyEnd, std::get<2>(val));
+                    break;
+                }
+                }
+
+                im.AssertValidity();
+            }
+
+            for (int key = -5; key < 250; key++)
+            {
+                assert(im[key] == columns(owner[key], tier[key], region[key]));
+            }
+
+            // A boundary wherever any column changes, and nowhere else
+            assert(im.Entries().size() <= owner.Entries().size() + tier.Entries().size() + region.Entries().size());
+        };
+
+        srand(45);
+        interval_map_test<columnar_interval_map<TestKey, columns>> im{ columns('A', 'x', 0) };
+        run(im);
+        interval_map_test<columnar_interval_map<TestKey, columns, small_map<TestKey, columns, 4>>> small{ columns('A', 'x', 0) };
+        run(small);
+
+        // Columns set back to what surrounds them leave no boundaries behind
+        interval_map_test<columnar_interval_map<int, std::pair<char, char>>> pairs{ std::make_pair('A', 'a') };
+        pairs.assign_column<0>(10, 20, 'B');
+        pairs.assign_column<1>(15, 25, 'b');
+        assert(pairs.Entries().size() == 4);
+        assert(pairs[17] == std::make_pair('B', 'b'));
+        pairs.assign_column<0>(10, 20, 'A');
+        assert(pairs.Entries().size() == 2);
+        pairs.assign_column<1>(0, 30, 'a');
+        assert(pairs.Entries().empty());
+
+        // Split and join of the underlying map stay reachable
+        interval_map_test<columnar_interval_map<int, std::pair<char, char>>> right{ std::make_pair('A', 'a') };
+        pairs.assign_column<0>(10, 20, 'B');
+        pairs.split(15, right);
+        assert(pairs[14] == std::make_pair('B', 'a') && pairs[15] == std::make_pair('A', 'a'));
+        assert(right[14] == std::make_pair('A', 'a') && right[19] == std::make_pair('B', 'a'));
+        pairs.join(right);
+        assert(pairs.Entries().size() == 2 && pairs[15] == std::make_pair('B', 'a'));
+    }
+
+    std::cout << "Interval multimap finds every overlapping interval" << std::endl;
+    {
+        srand(46);
+        for (int round = 0; round < 200; round++)
+        {
+            // Sizes around powers of two leave imaginary nodes in the tree
+            const int count = round < 100 ? round : rand() % 3000;
+            const int maxLength = round % 3 ? 20 : 2000;
+            interval_multimap<TestKey, int> im;
+            std::vector<std::pair<int, int>> reference;
+            for (int i = 0; i < count; i++)
+            {
+                int keyBegin = rand() % 1000;
+                int keyEnd = keyBegin + rand() % maxLength;
+                im.insert(keyBegin, keyEnd, i);
+                reference.emplace_back(keyBegin, keyEnd);
+            }
+
+            im.build();
+            for (int query = 0; query < 50; query++)
+            {
+                const int key = rand() % 1100 - 50;
+                std::vector<int> found;
+                im.for_each_containing(key, [&found](auto const& e) { found.push_back(e.val); });
+                std::vector<int> expected;
+                for (int i = 0; i < count; i++)
+                {
+                    if (reference[i].first <= key && key < reference[i].second)
+                    {
+                        expected.push_back(i);
+                    }
+                }
+
+                std::sort(found.begin(), found.end());
+                assert(found == expected);
+
+                const int keyEnd = key + rand() % 100;
+                found.clear();
+                im.for_each_overlapping(key, keyEnd, [&found](auto const& e) { found.push_back(e.val); });
+                expected.clear();
+                for (int i = 0; i < count; i++)
+                {
+                    if (key < keyEnd && reference[i].first < reference[i].second && reference[i].first < keyEnd && key < reference[i].second)
+                    {
+                        expected.push_back(i);
+                    }
+                }
+
+                std::sort(found.begin(), found.end());
+                assert(found == expected);
+            }
+        }
+
+        // Bulk built, empty intervals are dropped
+        std::vector<interval_multimap<int, char>::entry> entries;
+        entries.emplace_back(5, 10, 'A');
+        entries.emplace_back(0, 20, 'B');
+        entries.emplace_back(7, 7, 'C');
+        entries.emplace_back(9, 12, 'D');
+        interval_multimap<int, char> bulk(entries);
+        assert(bulk.size() == 3);
+        std::string found;
+        bulk.for_each_containing(9, [&found](auto const& e) { found += e.val; });
+        std::sort(found.begin(), found.end());
+        assert(found == "ABD");
+        found.clear();
+        bulk.for_each_overlapping(10, 12, [&found](auto const& e) { found += e.val; });
+        std::sort(found.begin(), found.end());
+        assert(found == "BD");
+    }
+
+    std::cout << "Rectangle map paints like a grid" << std::endl;
+    {
+        srand(47);
+        auto run = [](auto& im, int low, int size)
+        {
+            std::vector<std::vector<char>> grid(size, std::vector<char>(size, 'A'));
+            for (int i = 0; i < 300; i++)
+            {
+                int xBegin = rand() % size;
+                int xEnd = xBegin + rand() % (size - xBegin + 1);
+                int yBegin = rand() % size;
+                int yEnd = yBegin + rand() % (size / 2);
+                char val = 'A' + rand() % 4;
+                im.assign(low + xBegin, low + xEnd, yBegin, yEnd, val);
+                for (int x = xBegin; x < xEnd; x++)
+                {
+                    for (int y = yBegin; y < std::min(size, yEnd); y++)
+                    {
+                        grid[x][y] = val;
+                    }
+                }
+            }
+
+            for (int x = 0; x < size; x++)
+            {
+                for (int y = -1; y < size; y++)
+                {
+                    assert(im.at(low + x, y) == (y < 0 ? 'A' : grid[x][y]));
+                }
+            }
+        };
+
+        rectangle_map<int, TestKey, TestValue> signedMap{ 'A' };
+        run(signedMap, -40, 80);
+        rectangle_map<uint8_t, int, char> byteMap{ 'A' };
+        run(byteMap, 0, 255);
+        rectangle_map<uint64_t, int, char> wideMap{ 'A' };
+        run(wideMap, 0, 100);
+
+        // The ends of the range of X
+        rectangle_map<int64_t, int, char> edges{ 'A' };
+        const int64_t MIN = std::numeric_limits<int64_t>::min();
+        const int64_t MAX = std::numeric_limits<int64_t>::max();
+        edges.assign(MIN, MAX, 0, 10, 'B');
+        edges.assign(MIN, MIN + 1, 5, 10, 'C');
+        assert(edges.at(MIN, 0) == 'B' && edges.at(MIN, 5) == 'C' && edges.at(MIN + 1, 5) == 'B');
+        assert(edges.at(MAX - 1, 9) == 'B' && edges.at(MAX, 9) == 'A' && edges.at(0, 10) == 'A');
+
+        // Painting the same rectangle again reuses its nodes and boundaries
+        [[maybe_unused]] const size_t nodes = edges.node_count();
+        for (int i = 0; i < 100; i++)
+        {
+            edges.assign(MIN, MIN + 1, 5, 10, 'B' + i % 2);
+        }
+        assert(edges.node_count() == nodes);
+    }
+
+    std::cout << "Compact keeps the mapping and lays pooled nodes out in key order" << std::endl;
+    {
+        auto run = [](auto& im)
+        {
+            const int SIZE = 600;
+            std::vector<char> reference(SIZE, 'A');
+            srand(48);
+            for (int i = 0; i < 3000; i++)
+            {
+                int keyBegin = rand() % SIZE;
+                int keyEnd = keyBegin + rand() % (SIZE - keyBegin + 1);
+                char val = 'A' + rand() % 3;
+                im.assign(keyBegin, keyEnd, val);
+                std::fill(reference.begin() + keyBegin, reference.begin() + keyEnd, val);
+            }
+
+            [[maybe_unused]] const size_t size = im.Entries().size();
+            im.compact();
+            im.AssertValidity();
+            assert(im.Entries().size() == size);
+            for (int key = 0; key < SIZE; key++)
+            {
+                assert(im[key] == reference[key]);
+            }
+
+            // Still usable afterwards
+            im.assign(10, 20, 'D');
+            assert(im[9] == reference[9] && im[10] == 'D' && im[19] == 'D' && im[20] == reference[20]);
+            im.AssertValidity();
+        };
+
+        interval_map_ut im{ 'A' };
+        run(im);
+        treap_interval_map_ut treap{ 'A' };
+        run(treap);
+        small_interval_map_ut small{ 'A' };
+        run(small);
+        pool_interval_map_ut pooled{ 'A' };
+        run(pooled);
+
+        // Nodes of a churned map are all over its blocks, fresh ones follow key order
+        pool_interval_map_ut churned{ 'A' };
+        for (int i = 0; i < 4000; i++)
+        {
+            churned.assign(rand() % 2000, rand() % 2000, 'A' + rand() % 26);
+        }
+
+        [[maybe_unused]] const size_t reserved = churned.Entries().get_allocator().reserved_bytes();
+        churned.compact();
+        assert(churned.Entries().get_allocator().reserved_bytes() <= reserved);
+
+        // Below slotsPerBlock entries they all come from the first block
+        assert(churned.Entries().size() < pool_allocator<int>::slotsPerBlock);
+        for (auto it = churned.Entries().begin(); std::next(it) != churned.Entries().end(); ++it)
+        {
+            assert(&*it < &*std::next(it));
+        }
+
+        // A throwing copy leaves the map as it was, moved from values are emptied
+        struct fragile_value
+        {
+            fragile_value(char value, int* pCopiesLeft)
+                : value(value)
+                , pCopiesLeft(pCopiesLeft)
+            {}
+
+            fragile_value(fragile_value const& rhs)
+                : value(rhs.value)
+                , pCopiesLeft(rhs.pCopiesLeft)
+            {
+                if (0 == *pCopiesLeft)
+                {
+                    throw std::runtime_error("out of copies");
+                }
+
+                --*pCopiesLeft;
+            }
+
+            fragile_value(fragile_value&& rhs) noexcept
+                : value(rhs.value)
+                , pCopiesLeft(rhs.pCopiesLeft)
+            {
+                rhs.value = 0;
+            }
+
+            fragile_value& operator=(fragile_value const&) = default;
+
+            bool operator==(fragile_value const& rhs) const
+            {
+                return value == rhs.value;
+            }
+
+            char value;
+            int* pCopiesLeft;
+        };
+
+        int copiesLeft = -1;
+        interval_map_test<interval_map<int, fragile_value>> fragile{ fragile_value('A', &copiesLeft) };
+        for (int i = 0; i < 20; i++)
+        {
+            fragile.assign(i * 10, i * 10 + 5, fragile_value('B' + i % 3, &copiesLeft));
+        }
+
+        copiesLeft = 7;
+        [[maybe_unused]] bool thrown = false;
+        try
+        {
+            fragile.compact();
+        }
+        catch (std::runtime_error const&)
+        {
+            thrown = true;
+        }
+
+        assert(thrown);
+        copiesLeft = -1;
+        fragile.AssertValidity();
+        assert(40 == fragile.Entries().size());
+        for (int key = 0; key < 200; key++)
+        {
+            assert(fragile[key].value == (key % 10 < 5 ? 'B' + key / 10 % 3 : 'A'));
+        }
+
+        // Pending assigns are merged first
+        interval_map_test<buffered_interval_map<int, char>> buffered{ 'A' };
+        buffered.assign(0, 10, 'B');
+        buffered.assign(5, 15, 'C');
+        buffered.compact();
+        assert(0 == buffered.pending());
+        assert(buffered[4] == 'B' && buffered[5] == 'C' && buffered[14] == 'C' && buffered[15] == 'A');
+    }
+
+    std::cout << "Reset clears ranges to the initial value" << std::endl;
+    {
+        auto run = [](auto& im, int seed)
+        {
+            const int SIZE = 300;
+            std::vector<char> reference(SIZE, 'A');
+            srand(seed);
+            for (int i = 0; i < 2000; i++)
+            {
+                int keyBegin = rand() % SIZE;
+                int keyEnd = keyBegin + rand() % (SIZE - keyBegin + 1);
+                char val = 'A' + rand() % 3;
+                if (0 == rand() % 3)
+                {
+                    im.reset(keyBegin, keyEnd);
+                    val = 'A';
+                } else {
+                    im.assign(keyBegin, keyEnd, val);
+                }
+                std::fill(reference.begin() + keyBegin, reference.begin() + keyEnd, val);
+
+                if (0 == i % 100)
+                {
+                    im.AssertValidity();
+                    for (int key = 0; key < SIZE; key++)
+                    {
+                        assert(im[key] == reference[key]);
+                    }
+                }
+            }
+
+            // Ends of the range, and resets around a single interval
+            im.reset(0, SIZE);
+            assert(im.Entries().empty());
+            im.assign(10, 20, 'B');
+            im.reset(5, 10);
+            im.reset(20, 25);
+            assert(im.Entries().size() == 2);
+            im.reset(15, 15);
+            im.reset(12, 14);
+            assert(im[11] == 'B' && im[12] == 'A' && im[13] == 'A' && im[14] == 'B' && im[20] == 'A');
+            im.AssertValidity();
+            im.reset(0, 15);
+            assert(im[14] == 'A' && im[15] == 'B' && im[19] == 'B');
+            im.AssertValidity();
+        };
+
+        for (int seed = 0; seed < 4; seed++)
+        {
+            interval_map_ut im{ 'A' };
+            run(im, seed);
+            treap_interval_map_ut treap{ 'A' };
+            run(treap, seed);
+            small_interval_map_ut small{ 'A' };
+            run(small, seed);
+            radix_interval_map_ut radix{ 'A' };
+            run(radix, seed);
+            pool_interval_map_ut pooled{ 'A' };
+            run(pooled, seed);
+        }
+
+        // Buffered resets are logged in order with the assigns
+        buffered_interval_map_ut buffered{ 'A' };
+        buffered.assign(0, 100, 'B');
+        buffered.reset(20, 30);
+        buffered.assign(25, 40, 'C');
+        assert(buffered.pending() == 3);
+        assert(buffered[19] == 'B' && buffered[20] == 'A' && buffered[25] == 'C' && buffered[40] == 'B');
+
+        // Emptied blocks of the pool are returned, all but one
+        pool_interval_map_ut pooled{ 'A' };
+        for (int i = 0; i < 20000; i++)
+        {
+            pooled.assign(i * 2, i * 2 + 1, 'B');
+        }
+        [[maybe_unused]] const size_t reserved = pooled.Entries().get_allocator().reserved_bytes();
+        pooled.reset(0, 40000);
+        assert(pooled.Entries().empty());
+        assert(pooled.Entries().get_allocator().reserved_bytes() * 10 < reserved);
+    }
+
+    /*/////////////////////////////////////////////////////////////////////////////////
+    std::cout << "Speed test" << std::endl;
+    {
+        interval_map_ut im{ 'A' };
+        HR_Timer timer;
+        long long avgTime=0;
+
+        // Set srand() produce same inputs every time, since we want to time different
+        // implementations against eachother, not variable inputs
+        srand(0);
+        std::vector<std::tuple<int, int, char>> inputs;
+
+        const int RAND_N = 1000;
+        for (int i = 0; i < RAND_N; i++)
+        {
+            int keyBegin = rand() % RAND_N;
+            int keyEnd = keyBegin + (rand() % RAND_N);
+            char c = 'A' + rand() % 26;
+            inputs.emplace_back(keyBegin, keyEnd, c);
+        }
+
+        const int MAX_ITERATIONS = 1000;
+        for (int i = 0; i < MAX_ITERATIONS; i++)
+        {
+            im.clear();
+
+            timer.start();
+            for (auto tuple : inputs)
+            {
+                im.assign(std::get<0>(tuple), std::get<1>(tuple), std::get<2>(tuple));
+            }
+            timer.stop();
+
+            if (0 == i)
+                im.AssertValidity();
+
+            avgTime += timer.ms();
+        }
+        avgTime /= MAX_ITERATIONS;
+
+        std::cout<<"Finished in "<<avgTime<<"ms"<< std::endl;
+    }//*/
+    /*/////////////////////////////////////////////////////////////////////////////////
+    std::cout << "Cursor speed test" << std::endl;
+    {
+        interval_map_ut im{ 'A' };
+        HR_Timer timer;
+
+        srand(0);
+        const int RAND_N = 1000000;
+        for (int i = 0; i < 20000; i++)
+        {
+            int keyBegin = rand() % RAND_N;
+            im.assign(keyBegin, keyBegin + rand() % 200, 'A' + rand() % 26);
+        }
+
+        std::vector<int> sequential, nearSequential, random;
+        int key = 0;
+        for (int i = 0; i < RAND_N; i++)
+        {
+            sequential.push_back(i);
+            key += rand() % 16 - 4;
+            nearSequential.push_back(key);
+            random.push_back(rand() % RAND_N);
+        }
+
+        auto run = [&](const char* name, std::vector<int> const& keys)
+        {
+            int sum = 0;
+
+            timer.start();
+            for (int k : keys)
+            {
+                sum += im[k].m_value;
+            }
+            timer.stop();
+            const long long plainTime = timer.ms();
+
+            interval_map_ut::cursor cur{ im };
+            timer.start();
+            for (int k : keys)
+            {
+                sum -= cur[k].m_value;
+            }
+            timer.stop();
+
+            assert(0 == sum);
+            std::cout << name << ": operator[] " << plainTime << " us, cursor " << timer.ms() << " us" << std::endl;
+        };
+
+        run("Sequential", sequential);
+        run("Near-sequential", nearSequential);
+        run("Random", random);
+    }//*/
+    /*/////////////////////////////////////////////////////////////////////////////////
+    std::cout << "Buffered speed test" << std::endl;
+    {
+        HR_Timer timer;
+
+        srand(0);
+        std::vector<std::tuple<int, int, char>> inputs;
+
+        const int RAND_N = 100000;
+        for (int i = 0; i < RAND_N; i++)
+        {
+            int keyBegin = rand() % (RAND_N * 10);
+            int keyEnd = keyBegin + (rand() % 100);
+            char c = 'A' + rand() % 26;
+            inputs.emplace_back(keyBegin, keyEnd, c);
+        }
+
+        interval_map_ut reference{ 'A' };
+        timer.start();
+        for (auto tuple : inputs)
+        {
+            reference.assign(std::get<0>(tuple), std::get<1>(tuple), std::get<2>(tuple));
+        }
+        timer.stop();
+        std::cout << "assign: " << timer.ms() << " us" << std::endl;
+
+        buffered_interval_map_ut im{ 'A' };
+        timer.start();
+        for (auto tuple : inputs)
+        {
+            im.assign(std::get<0>(tuple), std::get<1>(tuple), std::get<2>(tuple));
+        }
+        im.flush();
+        timer.stop();
+        std::cout << "Buffered assign and flush: " << timer.ms() << " us" << std::endl;
+
+        im.AssertValidity();
+        for (int key = 0; key < RAND_N * 10; key += 7)
+        {
+            assert(im[key] == reference[key]);
+        }
+    }//*/
+    /*/////////////////////////////////////////////////////////////////////////////////
+    std::cout << "Parallel replay speed test" << std::endl;
+    {
+        HR_Timer timer;
+
+        srand(0);
+        std::vector<buffered_interval_map_ut::entry> log;
+
+        const int RAND_N = 10000000;
+        for (int i = 0; i < RAND_N; i++)
+        {
+            int keyBegin = (rand() % 32768) * 32768 + rand() % 32768;
+            int keyEnd = keyBegin + (rand() % 1000);
+            char c = 'A' + rand() % 26;
+            log.emplace_back(keyBegin, keyEnd, c);
+        }
+
+        long long singleThreadTime = 0;
+        for (unsigned threadCount = 1; threadCount <= std::max(1u, std::thread::hardware_concurrency()); threadCount *= 2)
+        {
+            buffered_interval_map_ut im{ 'A' };
+            timer.start();
+            im.replay(log.begin(), log.end(), threadCount);
+            timer.stop();
+
+            if (1 == threadCount)
+                singleThreadTime = timer.ms();
+
+            std::cout << threadCount << " threads: " << timer.ms() << " us, speedup " << double(singleThreadTime) / timer.ms() << std::endl;
+        }
+    }//*/
+    /*/////////////////////////////////////////////////////////////////////////////////
+    std::cout << "Overlay speed test" << std::endl;
+    {
+        HR_Timer timer;
+
+        srand(0);
+        const int RAND_N = 200000;
+        interval_map_ut base{ 'A' };
+        interval_map_ut overrides{ 'X' };
+        for (int i = 0; i < RAND_N; i++)
+        {
+            int keyBegin = rand() % (RAND_N * 10);
+            base.assign(keyBegin, keyBegin + rand() % 100, 'A' + rand() % 26);
+            keyBegin = rand() % (RAND_N * 10);
+            overrides.assign(keyBegin, keyBegin + rand() % 100, 'A' + rand() % 26);
+        }
+
+        interval_map_ut naive{ 'A' };
+        naive.combine(base, base, [](TestValue const& lhs, TestValue const&) { return lhs; });
+        timer.start();
+        for (auto it = overrides.Entries().begin(); it != overrides.Entries().end(); ++it)
+        {
+            auto next = std::next(it);
+            if (overrides.Entries().end() != next && !(it->second == 'X'))
+            {
+                naive.assign(it->first, next->first, it->second);
+            }
+        }
+        timer.stop();
+        std::cout << "assign per override: " << timer.ms() << " us" << std::endl;
+
+        interval_map_ut overlaid{ 'A' };
+        overlaid.combine(base, base, [](TestValue const& lhs, TestValue const&) { return lhs; });
+        timer.start();
+        overlaid.overlay(overrides);
+        timer.stop();
+        std::cout << "overlay: " << timer.ms() << " us" << std::endl;
+
+        zipped_interval_map_ut zipped{ std::make_pair(TestValue('A'), TestValue('A')) };
+        timer.start();
+        zipped.zip(base, overrides);
+        timer.stop();
+        std::cout << "zip: " << timer.ms() << " us" << std::endl;
+
+        overlaid.AssertValidity();
+        for (int key = 0; key < RAND_N * 10; key += 7)
+        {
+            assert(overlaid[key] == naive[key]);
+            assert(zipped[key].second == overrides[key]);
+        }
+    }//*/
+    /*/////////////////////////////////////////////////////////////////////////////////
+    std::cout << "Split and join speed test" << std::endl;
+    {
+        HR_Timer timer;
+
+        srand(0);
+        const int RAND_N = 1000000;
+        interval_map_ut im{ 'A' };
+        treap_interval_map_ut treapIm{ 'A' };
+        for (int i = 0; i < RAND_N; i++)
+        {
+            int keyBegin = (rand() % 32768) * 32768 + rand() % 32768;
+            int keyEnd = keyBegin + rand() % 1000;
+            char c = 'A' + rand() % 26;
+            im.assign(keyBegin, keyEnd, c);
+            treapIm.assign(keyBegin, keyEnd, c);
+        }
+
+        const int MAX_ITERATIONS = 100;
+        interval_map_ut right{ 'A' };
+        timer.start();
+        for (int i = 0; i < MAX_ITERATIONS; i++)
+        {
+            im.split((rand() % 32768) * 32768, right);
+            im.join(right);
+        }
+        timer.stop();
+        std::cout << "std::map split and join: " << timer.ms() / MAX_ITERATIONS << " us" << std::endl;
+
+        treap_interval_map_ut treapRight{ 'A' };
+        timer.start();
+        for (int i = 0; i < MAX_ITERATIONS; i++)
+        {
+            treapIm.split((rand() % 32768) * 32768, treapRight);
+            treapIm.join(treapRight);
+        }
+        timer.stop();
+        std::cout << "treap_map split and join: " << timer.ms() / MAX_ITERATIONS << " us" << std::endl;
+
+        im.AssertValidity();
+        treapIm.AssertValidity();
+    }//*/
+    /*/////////////////////////////////////////////////////////////////////////////////
+    std::cout << "Small map population speed test" << std::endl;
+    {
+        HR_Timer timer;
+
+        const int POPULATION = 200000;
+        const int ASSIGNS = 3;
+        std::vector<std::tuple<int, int, char>> inputs;
+        srand(0);
+        for (int i = 0; i < POPULATION * ASSIGNS; i++)
+        {
+            int keyBegin = rand() % 1000;
+            inputs.emplace_back(keyBegin, keyBegin + rand() % 100, 'A' + rand() % 26);
+        }
+
+        // Node of a std::map is 4 words besides the entry on the usual implementations
+        const size_t nodeOverhead = 4 * sizeof(void*);
+        const size_t entrySize = sizeof(std::pair<const TestKey, TestValue>);
+
+        // heapBytes estimates what one map holds outside of itself
+        auto run = [&](const char* name, auto& population, auto heapBytes)
+        {
+            timer.start();
+            for (size_t i = 0; i < inputs.size(); i++)
+            {
+                auto const& input = inputs[i];
+                population[i / ASSIGNS].assign(std::get<0>(input), std::get<1>(input), std::get<2>(input));
+            }
+            timer.stop();
+            const long long assignTime = timer.ms();
+
+            int sum = 0;
+            timer.start();
+            for (auto& im : population)
+            {
+                for (int key = 0; key < 1000; key += 50)
+                {
+                    sum += im[key].m_value;
+                }
+            }
+            timer.stop();
+
+            size_t bytes = population.size() * sizeof(population[0]);
+            for (auto& im : population)
+            {
+                bytes += heapBytes(im.Entries());
+            }
+
+            std::cout << name << ": assign " << assignTime << " us, look-up " << timer.ms() << " us, about " << bytes / 1024 << "KB (checksum " << sum << ")" << std::endl;
+        };
+
+        std::vector<interval_map_ut> maps(POPULATION, interval_map_ut{ 'A' });
+        run("std::map", maps, [&](auto const& entries) { return entries.size() * (entrySize + nodeOverhead); });
+
+        std::vector<interval_map_test<interval_map<TestKey, TestValue, small_map<TestKey, TestValue, 8>>>> smallMaps(POPULATION, { 'A' });
+        run("small_map<8>", smallMaps, [&](auto const& entries) { return entries.spilled() ? sizeof(std::map<TestKey, TestValue>) + entries.size() * (entrySize + nodeOverhead) : 0; });
+    }//*/
+    /*/////////////////////////////////////////////////////////////////////////////////
+    std::cout << "Dense storage speed test" << std::endl;
+    {
+        HR_Timer timer;
+
+        const int ASSIGNS = 1000000;
+        const int LOOKUPS = 10000000;
+        std::vector<std::tuple<uint16_t, uint16_t, char>> inputs;
+        std::vector<uint16_t> keys;
+        srand(0);
+        for (int i = 0; i < ASSIGNS; i++)
+        {
+            int keyBegin = rand() % 65536;
+            int keyEnd = keyBegin + rand() % 64;
+            inputs.emplace_back(static_cast<uint16_t>(keyBegin), static_cast<uint16_t>(keyEnd > 65535 ? 65535 : keyEnd), 'A' + rand() % 26);
+        }
+
+        for (int i = 0; i < LOOKUPS; i++)
+        {
+            keys.push_back(static_cast<uint16_t>(rand() % 65536));
+        }
+
+        auto run = [&](const char* name, auto& im)
+        {
+            timer.start();
+            for (auto const& input : inputs)
+            {
+                im.assign(std::get<0>(input), std::get<1>(input), std::get<2>(input));
+            }
+            timer.stop();
+            const long long assignTime = timer.ms();
+
+            int sum = 0;
+            timer.start();
+            for (uint16_t key : keys)
+            {
+                sum += im[key].m_value;
+            }
+            timer.stop();
+
+            std::cout << name << ": assign " << assignTime << " us, look-up " << timer.ms() << " us (checksum " << sum << ")" << std::endl;
+        };
+
+        interval_map_test<interval_map<uint16_t, TestValue>> treeMap{ 'A' };
+        run("std::map", treeMap);
+
+        dense_interval_map_ut<uint16_t> denseMap{ 'A' };
+        run("dense_storage", denseMap);
+    }//*/
+    /*/////////////////////////////////////////////////////////////////////////////////
+    std::cout << "Radix map speed test" << std::endl;
+    {
+        HR_Timer timer;
+
+        // Addresses in a few mappings scattered over the 64 bit space
+        const int CLUSTERS = 64;
+        const int ASSIGNS = 1000000;
+        const int LOOKUPS = 10000000;
+        std::vector<uint64_t> bases;
+        srand(0);
+        for (int i = 0; i < CLUSTERS; i++)
+        {
+            bases.push_back((uint64_t(rand() % 32768) << 48) | (uint64_t(rand() % 32768) << 32));
+        }
+
+        auto address = [&]()
+        {
+            return bases[rand() % CLUSTERS] + (uint64_t(rand() % 32768) << 12) + rand() % 4096;
+        };
+
+        std::vector<std::tuple<uint64_t, uint64_t, char>> inputs;
+        for (int i = 0; i < ASSIGNS; i++)
+        {
+            uint64_t keyBegin = address();
+            inputs.emplace_back(keyBegin, keyBegin + 64 + rand() % 4096, 'A' + rand() % 26);
+        }
+
+        std::vector<uint64_t> keys;
+        for (int i = 0; i < LOOKUPS; i++)
+        {
+            keys.push_back(address());
+        }
+
+        auto run = [&](const char* name, auto& im)
+        {
+            timer.start();
+            for (auto const& input : inputs)
+            {
+                im.assign(std::get<0>(input), std::get<1>(input), std::get<2>(input));
+            }
+            timer.stop();
+            const long long assignTime = timer.ms();
+
+            int sum = 0;
+            timer.start();
+            for (uint64_t key : keys)
+            {
+                sum += im[key].m_value;
+            }
+            timer.stop();
+
+            std::cout << name << ": assign " << assignTime << " us, look-up " << timer.ms() << " us (checksum " << sum << ")" << std::endl;
+        };
+
+        interval_map_test<interval_map<uint64_t, TestValue>> treeMap{ 'A' };
+        run("std::map", treeMap);
+
+        radix_interval_map_ut radixMap{ 'A' };
+        run("radix_map", radixMap);
+
+        // Read only baseline, binary search in a sorted vector of the boundaries
+        std::vector<std::pair<uint64_t, TestValue>> flat(treeMap.Entries().begin(), treeMap.Entries().end());
+        int sum = 0;
+        timer.start();
+        for (uint64_t key : keys)
+        {
+            auto it = std::upper_bound(flat.begin(), flat.end(), key, [](uint64_t lhs, std::pair<uint64_t, TestValue> const& rhs) { return lhs < rhs.first; });
+            sum += (flat.begin() == it ? TestValue('A') : std::prev(it)->second).m_value;
+        }
+        timer.stop();
+
+        std::cout << "flat vector: look-up " << timer.ms() << " us (checksum " << sum << ")" << std::endl;
+    }//*/
+    /*/////////////////////////////////////////////////////////////////////////////////
+    std::cout << "Frozen map speed test" << std::endl;
+    {
+        HR_Timer timer;
+
+        const int ASSIGNS = 1000000;
+        const int LOOKUPS = 10000000;
+        auto uniform = []() { return (uint64_t(rand() % 32768) << 30) | (uint64_t(rand() % 32768) << 15) | uint64_t(rand() % 32768); };
+
+        // Density falling as 1 / key, like a Zipfian distribution
+        auto zipfian = [&]() { return uint64_t(std::exp(std::log(double(uint64_t(1) << 44)) * (uniform() / double(uint64_t(1) << 45)))); };
+
+        std::vector<uint64_t> bases;
+        for (int i = 0; i < 64; i++)
+        {
+            bases.push_back(uniform() << 18);
+        }
+
+        auto clustered = [&]() { return bases[rand() % bases.size()] + rand() % 32768 * 8; };
+
+        auto run = [&](const char* name, auto keyOf)
+        {
+            srand(0);
+            interval_map_test<interval_map<uint64_t, TestValue>> im{ 'A' };
+            for (int i = 0; i < ASSIGNS; i++)
+            {
+                uint64_t keyBegin = keyOf();
+                im.assign(keyBegin, keyBegin + 1 + rand() % 4, 'A' + rand() % 26);
+            }
+
+            std::vector<uint64_t> keys;
+            for (int i = 0; i < LOOKUPS; i++)
+            {
+                keys.push_back(keyOf());
+            }
+
+            frozen_interval_map<uint64_t, TestValue> frozen(im);
+            frozen_interval_map<uint64_t, TestValue> indexed(im);
+            indexed.build_index();
+
+            // Look-ups are called directly, so they can be inlined into the loop
+            int sum[3] = {};
+            long long time[3] = {};
+            auto timeLookups = [&](int i, auto lookup)
+            {
+                timer.start();
+                for (uint64_t key : keys)
+                {
+                    sum[i] += lookup(key);
+                }
+                timer.stop();
+                time[i] = timer.ms();
+            };
+
+            timeLookups(0, [&](uint64_t key) { return im[key].m_value; });
+            timeLookups(1, [&](uint64_t key) { return frozen[key].m_value; });
+            timeLookups(2, [&](uint64_t key) { return indexed[key].m_value; });
+
+            std::cout << name << " (" << im.Entries().size() << " boundaries): std::map " << time[0] << " us, binary search " << time[1] << " us, interpolation " << time[2] << " us, " << (indexed.indexed() ? "largest error " + std::to_string(indexed.index_error()) : "no index") << " (checksums " << sum[0] << " " << sum[1] << " " << sum[2] << ")" << std::endl;
+        };
+
+        run("uniform", uniform);
+        run("zipfian", zipfian);
+        run("clustered", clustered);
+    }//*/
+    /*/////////////////////////////////////////////////////////////////////////////////
+    std::cout << "Versioned map speed test" << std::endl;
+    {
+        HR_Timer timer;
+
+        const int ASSIGNS = 1000000;
+        const int LOOKUPS = 1000000;
+        std::vector<std::tuple<int, int, char>> inputs;
+        srand(0);
+        for (int i = 0; i < ASSIGNS; i++)
+        {
+            int keyBegin = (rand() % 32768) * 32768 + rand() % 32768;
+            inputs.emplace_back(keyBegin, keyBegin + rand() % 100000, 'A' + rand() % 26);
+        }
+
+        versioned_interval_map<TestKey, TestValue> im{ 'A' };
+        interval_map_ut latest{ 'A' };
+        size_t copiedEntries = 0;
+        timer.start();
+        for (auto const& input : inputs)
+        {
+            im.assign(std::get<0>(input), std::get<1>(input), std::get<2>(input));
+        }
+        timer.stop();
+
+        // What keeping a copy per version would take
+        for (auto const& input : inputs)
+        {
+            latest.assign(std::get<0>(input), std::get<1>(input), std::get<2>(input));
+            copiedEntries += latest.Entries().size();
+        }
+
+        std::cout << "assign " << timer.ms() << " us, " << im.node_count() << " nodes for all versions, copies would hold " << copiedEntries << " entries" << std::endl;
+
+        int sum = 0;
+        timer.start();
+        for (int i = 0; i < LOOKUPS; i++)
+        {
+            sum += im.at((rand() % 32768) * 32768 + rand() % 32768, rand() % (ASSIGNS + 1)).m_value;
+        }
+        timer.stop();
+
+        std::cout << "as-of look-up " << timer.ms() << " us (checksum " << sum << ")" << std::endl;
+    }//*/
+    /*/////////////////////////////////////////////////////////////////////////////////
+    std::cout << "Journaled map speed test" << std::endl;
+    {
+        HR_Timer timer;
+
+        const int ASSIGNS = 100000;
+        for (size_t groupSize : { 1, 16, 256, 4096 })
+        {
+            std::filesystem::remove("journal_speed.journal");
+            std::filesystem::remove("journal_speed.checkpoint0");
+            std::filesystem::remove("journal_speed.checkpoint1");
+
+            // Syncing every assign is slow, fewer of those do
+            const int assignCount = groupSize < 16 ? ASSIGNS / 100 : ASSIGNS;
+            srand(0);
+            timer.start();
+            {
+                journaled_interval_map<int, char> im('A', "journal_speed", groupSize);
+                for (int i = 0; i < assignCount; i++)
+                {
+                    int keyBegin = (rand() % 32768) * 32768 + rand() % 32768;
+                    im.assign(keyBegin, keyBegin + rand() % 100000, 'A' + rand() % 26);
+                }
+            }
+            timer.stop();
+
+            std::cout << "group of " << groupSize << ": " << static_cast<long long>(assignCount * 1000000.0 / timer.ms()) << " assigns/s" << std::endl;
+        }
+
+        timer.start();
+        {
+            journaled_interval_map<int, char> im('A', "journal_speed");
+            std::cout << "recovered " << im.sequence() << " assigns from the journal";
+        }
+        timer.stop();
+        std::cout << " in " << timer.ms() << " us" << std::endl;
+
+        std::filesystem::remove("journal_speed.journal");
+        std::filesystem::remove("journal_speed.checkpoint0");
+        std::filesystem::remove("journal_speed.checkpoint1");
+    }//*/
+    /*/////////////////////////////////////////////////////////////////////////////////
+    std::cout << "Diff speed test" << std::endl;
+    {
+        HR_Timer timer;
+
+        const int ASSIGNS = 1000000;
+        const int CHANGES = 1000;
+        interval_map_ut a{ 'A' };
+        srand(0);
+        for (int i = 0; i < ASSIGNS; i++)
+        {
+            int keyBegin = (rand() % 32768) * 32768 + rand() % 32768;
+            a.assign(keyBegin, keyBegin + rand() % 1000, 'A' + rand() % 26);
+        }
+
+        interval_map_ut b = a;
+        for (int i = 0; i < CHANGES; i++)
+        {
+            int keyBegin = (rand() % 32768) * 32768 + rand() % 32768;
+            b.assign(keyBegin, keyBegin + rand() % 100000, 'A' + rand() % 26);
+        }
+
+        timer.start();
+        const auto changes = a.diff(b);
+        timer.stop();
+
+        std::cout << "diff of " << a.Entries().size() << " entries: " << changes.size() << " changes in " << timer.ms() << " us" << std::endl;
+    }//*/
+    /*/////////////////////////////////////////////////////////////////////////////////
+    std::cout << "Batch query speed test" << std::endl;
+    {
+        HR_Timer timer;
+
+        const int ASSIGNS = 1000000;
+        const int LOOKUPS = 20000000;
+        interval_map_ut im{ 'A' };
+        srand(0);
+        for (int i = 0; i < ASSIGNS; i++)
+        {
+            int keyBegin = (rand() % 32768) * 32768 + rand() % 32768;
+            im.assign(keyBegin, keyBegin + rand() % 1000, 'A' + rand() % 26);
+        }
+
+        frozen_interval_map<TestKey, TestValue> frozen(im);
+        std::vector<TestKey> keys;
+        for (int i = 0; i < LOOKUPS; i++)
+        {
+            keys.push_back((rand() % 32768) * 32768 + rand() % 32768);
+        }
+
+        std::vector<TestValue> out(keys.size(), 'A');
+        int sum = 0;
+        timer.start();
+        for (auto const& key : keys)
+        {
+            sum += frozen[key].m_value;
+        }
+        timer.stop();
+        std::cout << "one by one: " << static_cast<long long>(LOOKUPS / (timer.ms() / 1000000.0)) << " keys/s (checksum " << sum << ")" << std::endl;
+
+        for (unsigned threadCount : { 1, 2, 4, 8 })
+        {
+            frozen_query_engine<TestKey, TestValue> engine(frozen, threadCount);
+            timer.start();
+            engine.resolve(keys.data(), keys.size(), out.data());
+            timer.stop();
+            std::cout << threadCount << " threads: " << static_cast<long long>(LOOKUPS / (timer.ms() / 1000000.0)) << " keys/s" << std::endl;
+        }
+
+        std::sort(keys.begin(), keys.end());
+        for (unsigned threadCount : { 1, 2, 4, 8 })
+        {
+            frozen_query_engine<TestKey, TestValue> engine(frozen, threadCount);
+            timer.start();
+            engine.resolve(keys.data(), keys.size(), out.data());
+            timer.stop();
+            std::cout << threadCount << " threads, sorted keys: " << static_cast<long long>(LOOKUPS / (timer.ms() / 1000000.0)) << " keys/s" << std::endl;
+        }
+    }//*/
+    /*/////////////////////////////////////////////////////////////////////////////////
+    std::cout << "Concurrent map scalability test" << std::endl;
+    {
+        HR_Timer timer;
+
+        // Every thread assigns small ranges in its own slice of the keys
+        const int ASSIGNS = 400000;
+        const int KEYS = 1 << 24;
+        auto run = [&](unsigned threadCount, auto&& assign)
+        {
+            std::vector<std::thread> threads;
+            timer.start();
+            for (unsigned t = 0; t < threadCount; t++)
+            {
+                threads.emplace_back([&assign, threadCount, t]()
+                {
+                    const int sliceSize = KEYS / threadCount;
+                    uint32_t random = 2463534242u + t;
+                    for (int i = 0; i < ASSIGNS / static_cast<int>(threadCount); i++)
+                    {
+                        random ^= random << 13;
+                        random ^= random >> 17;
+                        random ^= random << 5;
+                        const int keyBegin = t * sliceSize + random % (sliceSize - 64);
+                        assign(keyBegin, keyBegin + 1 + (random >> 26), 'A' + (random >> 8) % 4);
+                    }
+                });
+            }
+
+            for (auto& thread : threads)
+            {
+                thread.join();
+            }
+            timer.stop();
+            return static_cast<long long>(ASSIGNS / (timer.ms() / 1000000.0));
+        };
+
+        std::vector<int> splits;
+        for (int split = KEYS / 256; split < KEYS; split += KEYS / 256)
+        {
+            splits.push_back(split);
+        }
+
+        for (unsigned threadCount : { 1, 2, 4, 8 })
+        {
+            interval_map_ut locked{ 'A' };
+            std::mutex mutex;
+            const long long lockedRate = run(threadCount, [&](int keyBegin, int keyEnd, char val)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                locked.assign(keyBegin, keyEnd, val);
+            });
+
+            concurrent_interval_map<int, char> sharded('A', splits);
+            const long long shardedRate = run(threadCount, [&](int keyBegin, int keyEnd, char val)
+            {
+                sharded.assign(keyBegin, keyEnd, val);
+            });
+
+            std::cout << threadCount << " threads: single lock " << lockedRate << " assigns/s, 256 shards " << shardedRate << " assigns/s" << std::endl;
+        }
+    }//*/
+    /*/////////////////////////////////////////////////////////////////////////////////
+    std::cout << "Seqlock map reader latency test" << std::endl;
+    {
+        // Percentiles of batches of look-ups timed on a reader thread
+        const int BATCHES = 200000;
+        const int BATCH = 16;
+        auto measure = [&](auto&& lookup, auto&& write)
+        {
+            std::atomic<bool> reading{ true };
+            std::thread writer([&]()
+            {
+                uint32_t random = 88675123u;
+                while (reading)
+                {
+                    random ^= random << 13;
+                    random ^= random >> 17;
+                    random ^= random << 5;
+                    write(random);
+                }
+            });
+
+            std::vector<long long> latencies;
+            latencies.reserve(BATCHES);
+            uint32_t random = 2463534242u;
+            int sum = 0;
+            for (int i = 0; i < BATCHES; i++)
+            {
+                const auto start = std::chrono::steady_clock::now();
+                for (int j = 0; j < BATCH; j++)
+                {
+                    random ^= random << 13;
+                    random ^= random >> 17;
+                    random ^= random << 5;
+                    sum += lookup(random);
+                }
+                const auto stop = std::chrono::steady_clock::now();
+                latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count() / BATCH);
+            }
+
+            reading = false;
+            writer.join();
+            std::sort(latencies.begin(), latencies.end());
+            std::cout << "p50 " << latencies[BATCHES / 2] << " ns, p99 " << latencies[BATCHES * 99 / 100] << " ns, p99.9 " << latencies[BATCHES * 999 / 1000] << " ns (checksum " << sum << ")" << std::endl;
+        };
+
+        // Reader latency shouldn't depend on how many boundaries the writer shifts
+        for (const int ASSIGNS : { 10000, 1000000 })
+        {
+            const int RANGE = ASSIGNS * 100;
+            seqlock_interval_map<int, char> im('A');
+            interval_map_test<interval_map<int, char>> locked{ 'A' };
+            std::shared_mutex mutex;
+            srand(0);
+            for (int i = 0; i < ASSIGNS; i++)
+            {
+                int keyBegin = (rand() % 32768 * 32768 + rand() % 32768) % RANGE;
+                int keyEnd = keyBegin + rand() % 100;
+                char val = 'A' + rand() % 26;
+                im.assign(keyBegin, keyEnd, val);
+                locked.assign(keyBegin, keyEnd, val);
+            }
+
+            auto seqlockLookup = [&](uint32_t random) { return im[random % RANGE]; };
+            auto lockedLookup = [&](uint32_t random) { std::shared_lock<std::shared_mutex> lock(mutex); return locked[random % RANGE]; };
+
+            std::cout << im.size() << " boundaries" << std::endl;
+            std::cout << "seqlock, writer idle: ";
+            measure(seqlockLookup, [](uint32_t) { std::this_thread::yield(); });
+            std::cout << "seqlock, writer assigning: ";
+            measure(seqlockLookup, [&](uint32_t random) { im.assign(random % RANGE, random % RANGE + 1 + (random >> 26), 'A' + (random >> 8) % 26); });
+            std::cout << "shared_mutex, writer assigning: ";
+            measure(lockedLookup, [&](uint32_t random)
+            {
+                std::unique_lock<std::shared_mutex> lock(mutex);
+                locked.assign(random % RANGE, random % RANGE + 1 + (random >> 26), 'A' + (random >> 8) % 26);
+            });
+        }
+    }//*/
+    /*/////////////////////////////////////////////////////////////////////////////////
+    std::cout << "Interval set speed test" << std::endl;
+    {
+        HR_Timer timer;
+
+        // Ascending ranges, spread thin or packed so most chunks are bitmaps
+        auto build = [](uint32_t seed, uint32_t maxGap, auto& set, auto& map)
+        {
+            uint32_t random = seed;
+            uint32_t key = 0;
+            for (int i = 0; i < 500000; i++)
+            {
+                random ^= random << 13;
+                random ^= random >> 17;
+                random ^= random << 5;
+                key += 1 + random % maxGap;
+                const uint32_t length = 1 + (random >> 16) % maxGap;
+                set.assign(key, key + length, true);
+                map.assign(key, key + length, true);
+                key += length;
+            }
+        };
+
+        for (uint32_t maxGap : { 2000u, 8u })
+        {
+            interval_set_ut<uint32_t> a{ false };
+            interval_set_ut<uint32_t> b{ false };
+            interval_map_test<interval_map<uint32_t, bool>> mapA{ false };
+            interval_map_test<interval_map<uint32_t, bool>> mapB{ false };
+            timer.start();
+            build(2463534242u, maxGap, a, mapA);
+            timer.stop();
+            std::cout << "ascending set and map assigns: " << timer.ms() << " us" << std::endl;
+            build(88675123u, maxGap, b, mapB);
+            std::cout << "gaps up to " << maxGap << ": " << a.flips().size() << " flips, " << a.bitmap_count() << " bitmaps" << std::endl;
+
+            interval_set_ut<uint32_t> result{ false };
+            timer.start();
+            result.unite(a);
+            result.intersect(b);
+            timer.stop();
+            std::cout << "set union and intersection: " << timer.ms() << " us" << std::endl;
+
+            interval_map_test<interval_map<uint32_t, bool>> mapResult{ false };
+            timer.start();
+            mapResult.combine(mapA, mapB, [](bool lhs, bool rhs) { return lhs && rhs; });
+            timer.stop();
+            std::cout << "interval_map combine: " << timer.ms() << " us" << std::endl;
+
+            std::vector<uint32_t> keys;
+            uint32_t random = 12345u;
+            for (int i = 0; i < 2000000; i++)
+            {
+                random ^= random << 13;
+                random ^= random >> 17;
+                random ^= random << 5;
+                keys.push_back(random % (maxGap * 1000000));
+            }
+
+            std::sort(keys.begin(), keys.end());
+            std::unique_ptr<bool[]> out(new bool[keys.size()]);
+            int sum = 0;
+            timer.start();
+            for (auto key : keys)
+            {
+                sum += mapA[key];
+            }
+            timer.stop();
+            std::cout << "interval_map look-ups: " << timer.ms() << " us (checksum " << sum << ")" << std::endl;
+
+            timer.start();
+            a.contains(keys.data(), keys.size(), out.get());
+            timer.stop();
+            std::cout << "set membership batch, sorted keys: " << timer.ms() << " us (checksum " << std::count(out.get(), out.get() + keys.size(), true) << ")" << std::endl;
+        }
+    }//*/
+    /*/////////////////////////////////////////////////////////////////////////////////
+    std::cout << "Packed map speed test" << std::endl;
+    {
+        HR_Timer timer;
+
+        const int BOUNDARIES = 4000000;
+        const int LOOKUPS = 4000000;
+        interval_map_test<interval_map<uint64_t, char>> im{ 'A' };
+        uint64_t random = 88172645463325252ull;
+        uint64_t key = 0;
+        for (int i = 0; i < BOUNDARIES / 2; i++)
+        {
+            random ^= random << 13;
+            random ^= random >> 7;
+            random ^= random << 17;
+            key += 1 + random % 4096;
+            const uint64_t length = 1 + (random >> 32) % 4096;
+            im.assign(key, key + length, 'B' + (random >> 40) % 25);
+            key += length;
+        }
+
+        frozen_interval_map<uint64_t, char> frozen(im);
+        packed_interval_map<uint64_t, char> packed(im);
+
+        // Red-black tree node: colour, three links and the entry, before allocator overhead
+        const size_t mapBytes = im.Entries().size() * (4 * sizeof(void*) + sizeof(std::pair<const uint64_t, char>));
+        std::cout << im.Entries().size() << " boundaries" << std::endl;
+        std::cout << "std::map at least " << mapBytes / 1024 << " KiB, flat arrays " << im.Entries().size() * (sizeof(uint64_t) + sizeof(char)) / 1024 << " KiB, packed " << packed.memory_bytes() / 1024 << " KiB" << std::endl;
+
+        std::vector<uint64_t> keys;
+        for (int i = 0; i < LOOKUPS; i++)
+        {
+            random ^= random << 13;
+            random ^= random >> 7;
+            random ^= random << 17;
+            keys.push_back(random % key);
+        }
+
+        int sum = 0;
+        timer.start();
+        for (auto lookup : keys)
+        {
+            sum += im[lookup];
+        }
+        timer.stop();
+        std::cout << "std::map: " << timer.ms() << " us (checksum " << sum << ")" << std::endl;
+
+        sum = 0;
+        timer.start();
+        for (auto lookup : keys)
+        {
+            sum += frozen[lookup];
+        }
+        timer.stop();
+        std::cout << "frozen: " << timer.ms() << " us (checksum " << sum << ")" << std::endl;
+
+        sum = 0;
+        timer.start();
+        for (auto lookup : keys)
+        {
+            sum += packed[lookup];
+        }
+        timer.stop();
+        std::cout << "packed: " << timer.ms() << " us (checksum " << sum << ")" << std::endl;
+    }//*/
+    /*/////////////////////////////////////////////////////////////////////////////////
+    std::cout << "Columnar map speed test" << std::endl;
+    {
+        HR_Timer timer;
+
+        // Owner, tier and region of keys, region changing far less often
+        const int ASSIGNS = 300000;
+        const int LOOKUPS = 3000000;
+        srand(0);
+        std::vector<std::tuple<int, int, int, int>> inputs;
+        for (int i = 0; i < ASSIGNS; i++)
+        {
+            int keyBegin = (rand() % 32768) * 32768 + rand() % 32768;
+            int column = rand() % 3;
+            inputs.emplace_back(column, keyBegin, keyBegin + 1 + rand() % (2 == column ? 100000 : 1000), rand() % 8);
+        }
+
+        std::vector<int> keys;
+        for (int i = 0; i < LOOKUPS; i++)
+        {
+            keys.push_back((rand() % 32768) * 32768 + rand() % 32768);
+        }
+
+        interval_map_test<interval_map<int, int>> owner{ 0 };
+        interval_map_test<interval_map<int, int>> tier{ 0 };
+        interval_map_test<interval_map<int, int>> region{ 0 };
+        timer.start();
+        for (auto const& [column, keyBegin, keyEnd, val] : inputs)
+        {
+            (0 == column ? owner : 1 == column ? tier : region).assign(keyBegin, keyEnd, val);
+        }
+        timer.stop();
+        std::cout << "separate maps, assign: " << timer.ms() << " us, " << owner.Entries().size() + tier.Entries().size() + region.Entries().size() << " boundaries" << std::endl;
+
+        long long sum = 0;
+        timer.start();
+        for (int key : keys)
+        {
+            sum += owner[key] + tier[key] + region[key];
+        }
+        timer.stop();
+        std::cout << "separate maps, look-up: " << timer.ms() << " us (checksum " << sum << ")" << std::endl;
+
+        interval_map_test<columnar_interval_map<int, std::tuple<int, int, int>>> columnar{ std::make_tuple(0, 0, 0) };
+        timer.start();
+        for (auto const& [column, keyBegin, keyEnd, val] : inputs)
+        {
+            if (0 == column)
+            {
+                columnar.assign_column<0>(keyBegin, keyEnd, val);
+            } else if (1 == column) {
+                columnar.assign_column<1>(keyBegin, keyEnd, val);
+            } else {
+                columnar.assign_column<2>(keyBegin, keyEnd, val);
+            }
+        }
+        timer.stop();
+        std::cout << "columnar, assign: " << timer.ms() << " us, " << columnar.Entries().size() << " boundaries" << std::endl;
+
+        sum = 0;
+        timer.start();
+        for (int key : keys)
+        {
+            auto const& [ownerVal, tierVal, regionVal] = columnar[key];
+            sum += ownerVal + tierVal + regionVal;
+        }
+        timer.stop();
+        std::cout << "columnar, look-up: " << timer.ms() << " us (checksum " << sum << ")" << std::endl;
+    }//*/
+    /*/////////////////////////////////////////////////////////////////////////////////
+    std::cout << "Interval multimap speed test" << std::endl;
+    {
+        HR_Timer timer;
+
+        const int INTERVALS = 1000000;
+        const int QUERIES = 200000;
+        srand(0);
+        std::vector<interval_multimap<int, int>::entry> entries;
+        for (int i = 0; i < INTERVALS; i++)
+        {
+            int keyBegin = (rand() % 32768) * 32768 + rand() % 32768;
+            entries.emplace_back(keyBegin, keyBegin + 1 + rand() % 10000, i);
+        }
+
+        timer.start();
+        interval_multimap<int, int> im(entries);
+        timer.stop();
+        std::cout << "bulk build: " << timer.ms() << " us" << std::endl;
+
+        std::vector<int> keys;
+        for (int i = 0; i < QUERIES; i++)
+        {
+            keys.push_back((rand() % 32768) * 32768 + rand() % 32768);
+        }
+
+        long long found = 0;
+        timer.start();
+        for (int key : keys)
+        {
+            im.for_each_containing(key, [&found](auto const& e) { found += e.val; });
+        }
+        timer.stop();
+        std::cout << "stabbing: " << timer.ms() << " us (checksum " << found << ")" << std::endl;
+
+        found = 0;
+        timer.start();
+        for (int key : keys)
+        {
+            im.for_each_overlapping(key, key + 100000, [&found](auto const& e) { found += e.val; });
+        }
+        timer.stop();
+        std::cout << "overlap with 100000 keys: " << timer.ms() << " us (checksum " << found << ")" << std::endl;
+
+        // Scanning all intervals, on a hundredth of the queries
+        found = 0;
+        timer.start();
+        for (int i = 0; i < QUERIES / 100; i++)
+        {
+            for (auto const& e : entries)
+            {
+                found += e.keyBegin <= keys[i] && keys[i] < e.keyEnd ? e.val : 0;
+            }
+        }
+        timer.stop();
+        std::cout << "stabbing by scan, 1/100 of the queries: " << timer.ms() << " us (checksum " << found << ")" << std::endl;
+    }//*/
+    /*/////////////////////////////////////////////////////////////////////////////////
+    std::cout << "Rectangle map speed test" << std::endl;
+    {
+        HR_Timer timer;
+
+        const int RECTANGLES = 200000;
+        const int LOOKUPS = 1000000;
+        const int SIZE = 1 << 20;
+        srand(0);
+        std::vector<std::tuple<int, int, int, int, char>> rectangles;
+        for (int i = 0; i < RECTANGLES; i++)
+        {
+            int x = (rand() % 1024) * 1024 + rand() % 1024;
+            int y = (rand() % 1024) * 1024 + rand() % 1024;
+            rectangles.emplace_back(x, x + 1 + rand() % 20000, y, y + 1 + rand() % 20000, 'A' + rand() % 26);
+        }
+
+        rectangle_map<uint32_t, int, char> im{ 'A' };
+        timer.start();
+        for (auto const& [xBegin, xEnd, yBegin, yEnd, val] : rectangles)
+        {
+            im.assign(xBegin, xEnd, yBegin, yEnd, val);
+        }
+        timer.stop();
+        std::cout << "assign: " << timer.ms() << " us, " << im.node_count() << " nodes" << std::endl;
+
+        std::vector<std::pair<int, int>> points;
+        for (int i = 0; i < LOOKUPS; i++)
+        {
+            points.emplace_back(rand() % SIZE, rand() % SIZE);
+        }
+
+        int sum = 0;
+        timer.start();
+        for (auto const& [x, y] : points)
+        {
+            sum += im.at(x, y);
+        }
+        timer.stop();
+        std::cout << "look-up: " << timer.ms() << " us (checksum " << sum << ")" << std::endl;
+
+        // Newest rectangle containing the point, on a thousandth of the points
+        sum = 0;
+        timer.start();
+        for (int i = 0; i < LOOKUPS / 1000; i++)
+        {
+            auto const& [x, y] = points[i];
+            char val = 'A';
+            for (auto it = rectangles.rbegin(); it != rectangles.rend(); ++it)
+            {
+                auto const& [xBegin, xEnd, yBegin, yEnd, rectangleVal] = *it;
+                if (xBegin <= x && x < xEnd && yBegin <= y && y < yEnd)
+                {
+                    val = rectangleVal;
+                    break;
+                }
+            }
+
+            sum += val;
+        }
+        timer.stop();
+        std::cout << "look-up by scan, 1/1000 of the points: " << timer.ms() << " us (checksum " << sum << ")" << std::endl;
+    }//*/
+    /*/////////////////////////////////////////////////////////////////////////////////
+    std::cout << "Compact speed test" << std::endl;
+    {
+        HR_Timer timer;
+
+        // Intervals painted in random order, then most of them painted over,
+        // so the remaining nodes are scattered over the memory held
+        const int INTERVALS = 1000000;
+        const int LOOKUPS = 4000000;
+        srand(0);
+        std::vector<int> order(INTERVALS);
+        for (int i = 0; i < INTERVALS; i++)
+        {
+            order[i] = i;
+        }
+        for (int i = INTERVALS - 1; i > 0; i--)
+        {
+            std::swap(order[i], order[rand() % (i + 1)]);
+        }
+
+        std::vector<int> randomKeys;
+        for (int i = 0; i < LOOKUPS; i++)
+        {
+            randomKeys.push_back((rand() % 2048) * 2048 + rand() % 2048);
+        }
+
+        auto lookUps = [&](const char* name, auto& im, size_t reservedBytes)
+        {
+            int sum = 0;
+            timer.start();
+            for (int key : randomKeys)
+            {
+                sum += im[key].m_value;
+            }
+            timer.stop();
+            const long long randomTime = timer.ms();
+
+            timer.start();
+            for (int i = 0; i < LOOKUPS; i++)
+            {
+                sum += im[i].m_value;
+            }
+            timer.stop();
+
+            std::cout << name << ": " << im.Entries().size() << " entries, " << LOOKUPS << " random look-ups " << randomTime << " us, in key order " << timer.ms() << " us";
+            if (reservedBytes)
+            {
+                std::cout << ", " << reservedBytes / 1024 << "KB reserved";
+            }
+            std::cout << " (checksum " << sum << ")" << std::endl;
+        };
+
+        auto run = [&](const char* name, auto& im, auto reservedBytes)
+        {
+            for (int i : order)
+            {
+                im.assign(i * 4, i * 4 + 2, 'B' + i % 25);
+            }
+            for (int i = 0; i < INTERVALS; i += 4)
+            {
+                im.assign(i * 4, i * 4 + 12, 'A');
+            }
+
+            std::cout << name << std::endl;
+            lookUps("churned", im, reservedBytes(im));
+
+            timer.start();
+            im.compact();
+            timer.stop();
+            std::cout << "compact: " << timer.ms() << " us" << std::endl;
+            lookUps("compacted", im, reservedBytes(im));
+        };
+
+        interval_map_ut im{ 'A' };
+        run("std::map", im, [](auto const&) { return size_t(0); });
+        pool_interval_map_ut pooled{ 'A' };
+        run("std::map with pool_allocator", pooled, [](auto const& im) { return im.Entries().get_allocator().reserved_bytes(); });
+    }//*/
+    /*/////////////////////////////////////////////////////////////////////////////////
+    std::cout << "Reset speed test" << std::endl;
+    {
+        HR_Timer timer;
+
+        // Wide clears, each taking out a tenth of the entries
+        const int INTERVALS = 500000;
+        const int CLEARS = 10;
+        const int WIDTH = INTERVALS * 4 / CLEARS;
+
+        auto run = [&](const char* name, auto& im, auto clear, auto reservedBytes)
+        {
+            for (int i = 0; i < INTERVALS; i++)
+            {
+                im.assign(i * 4, i * 4 + 2, 'B' + i % 25);
+            }
+            const size_t reserved = reservedBytes(im);
+
+            timer.start();
+            for (int i = 0; i < CLEARS; i++)
+            {
+                clear(im, i * WIDTH, (i + 1) * WIDTH);
+            }
+            timer.stop();
+
+            std::cout << name << ": " << timer.ms() << " us";
+            if (reserved)
+            {
+                std::cout << ", " << reserved / 1024 << "KB reserved before, " << reservedBytes(im) / 1024 << "KB after";
+            }
+            std::cout << " (" << im.Entries().size() << " entries left)" << std::endl;
+        };
+
+        auto byAssign = [](auto& im, int keyBegin, int keyEnd) { im.assign(keyBegin, keyEnd, 'A'); };
+        auto byReset = [](auto& im, int keyBegin, int keyEnd) { im.reset(keyBegin, keyEnd); };
+        auto noPool = [](auto const&) { return size_t(0); };
+        auto pool = [](auto const& im) { return im.Entries().get_allocator().reserved_bytes(); };
+
+        {
+            interval_map_ut im{ 'A' };
+            run("std::map assign", im, byAssign, noPool);
+        }
+        {
+            interval_map_ut im{ 'A' };
+            run("std::map reset", im, byReset, noPool);
+        }
+        {
+            pool_interval_map_ut im{ 'A' };
+            run("std::map with pool_allocator assign", im, byAssign, pool);
+        }
+        {
+            pool_interval_map_ut im{ 'A' };
+            run("std::map with pool_allocator reset", im, byReset, pool);
+        }
+        {
+            treap_interval_map_ut im{ 'A' };
+            run("treap_map assign", im, byAssign, noPool);
+        }
+        {
+            treap_interval_map_ut im{ 'A' };
+            run("treap_map reset", im, byReset, noPool);
+        }
     }//*/
 }
\ No newline at end of file
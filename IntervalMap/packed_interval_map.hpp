@@ -0,0 +1,159 @@
+/* Copyright (C) 2024, Valkai-Nmeth Bla-rs */
+
+#ifndef INTERVAL_MAP_PACKED_INTERVAL_MAP_HPP
+#define INTERVAL_MAP_PACKED_INTERVAL_MAP_HPP
+
+#include "interval_map.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+// Read only copy of an interval_map over unsigned integral keys, for maps too
+// large to keep as plain arrays. The boundary keys are cut into blocks of
+// blockSize keys, each stored as offsets from its first key (frame of reference)
+// bit-packed to the width its largest offset needs. Only the first key of every
+// block is kept as is, as a skip index. A look-up binary searches the skip index,
+// then the packed offsets of one block, extracting just the offsets it compares.
+template<typename K, typename V>
+class packed_interval_map
+{
+    static_assert(std::is_integral_v<K> && std::is_unsigned_v<K>, "packed_interval_map needs an unsigned integral key type");
+
+public:
+    static constexpr size_t blockSize = 128;
+
+    template<typename Map>
+    packed_interval_map(interval_map<K, V, Map> const& im)
+        : m_valBegin(im.m_valBegin)
+    {
+        std::vector<K> keys;
+        keys.reserve(im.m_map.size());
+        m_values.reserve(im.m_map.size());
+        for (auto const& entry : im.m_map)
+        {
+            keys.push_back(entry.first);
+            m_values.push_back(entry.second);
+        }
+
+        const size_t blockCount = (keys.size() + blockSize - 1) / blockSize;
+        m_firsts.reserve(blockCount);
+        m_blocks.reserve(blockCount);
+        for (size_t first = 0; first < keys.size(); first += blockSize)
+        {
+            const size_t last = std::min(keys.size(), first + blockSize);
+            const K frame = keys[first];
+            const unsigned width = bitWidth(keys[last - 1] - frame);
+
+            m_firsts.push_back(frame);
+            m_blocks.push_back({ m_words.size(), width });
+            m_words.resize(m_words.size() + ((last - first) * width + 63) / 64, 0);
+            if (0 == width)
+            {
+                // A block of one key has no words, its only offset is 0
+                continue;
+            }
+
+            uint64_t* pWords = m_words.data() + m_blocks.back().offset;
+            for (size_t i = first; i < last; i++)
+            {
+                const size_t bit = (i - first) * width;
+                const uint64_t delta = static_cast<uint64_t>(keys[i] - frame);
+                pWords[bit / 64] |= delta << (bit % 64);
+                if (bit % 64 + width > 64)
+                {
+                    pWords[bit / 64 + 1] |= delta >> (64 - bit % 64);
+                }
+            }
+        }
+
+        m_words.shrink_to_fit();
+    }
+
+    // look-up of the value associated with key
+    V const& operator[](K const& key) const
+    {
+        const size_t block = std::upper_bound(m_firsts.begin(), m_firsts.end(), key) - m_firsts.begin();
+        if (0 == block)
+        {
+            return m_valBegin;
+        }
+
+        // The first offset of a block is 0, so the answer is at least 1
+        const size_t first = (block - 1) * blockSize;
+        const uint64_t delta = static_cast<uint64_t>(key - m_firsts[block - 1]);
+        block_info const& info = m_blocks[block - 1];
+        uint64_t const* pWords = m_words.data() + info.offset;
+        size_t index = 0;
+        for (size_t count = std::min(blockSize, m_values.size() - first); count > 0;)
+        {
+            const size_t half = count / 2;
+            if (delta < extract(pWords, index + half, info.width))
+            {
+                count = half;
+            } else {
+                index += half + 1;
+                count -= half + 1;
+            }
+        }
+
+        return m_values[first + index - 1];
+    }
+
+    size_t size() const
+    {
+        return m_values.size();
+    }
+
+    // Bytes held by the keys, skip index and values
+    size_t memory_bytes() const
+    {
+        return m_words.capacity() * sizeof(uint64_t) + m_firsts.capacity() * sizeof(K) + m_blocks.capacity() * sizeof(block_info) + m_values.capacity() * sizeof(V);
+    }
+
+private:
+    struct block_info
+    {
+        size_t offset;
+        unsigned width;
+    };
+
+    static unsigned bitWidth(uint64_t value)
+    {
+        unsigned width = 0;
+        for (; value; value >>= 1)
+        {
+            width++;
+        }
+
+        return width;
+    }
+
+    // Offset index of a block packed width bits each
+    static uint64_t extract(uint64_t const* pWords, size_t index, unsigned width)
+    {
+        if (0 == width)
+        {
+            return 0;
+        }
+
+        const size_t bit = index * width;
+        const unsigned shift = bit % 64;
+        uint64_t value = pWords[bit / 64] >> shift;
+        if (shift && shift + width > 64)
+        {
+            value |= pWords[bit / 64 + 1] << (64 - shift);
+        }
+
+        return width < 64 ? value & ((uint64_t(1) << width) - 1) : value;
+    }
+
+    V m_valBegin;
+    std::vector<K> m_firsts;
+    std::vector<block_info> m_blocks;
+    std::vector<uint64_t> m_words;
+    std::vector<V> m_values;
+};
+
+#endif // INTERVAL_MAP_PACKED_INTERVAL_MAP_HPP
\ No newline at end of file
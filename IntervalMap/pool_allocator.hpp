@@ -0,0 +1,304 @@
+/* Copyright (C) 2024, Valkai-Nmeth Bla-rs */
+
+#ifndef INTERVAL_MAP_POOL_ALLOCATOR_HPP
+#define INTERVAL_MAP_POOL_ALLOCATOR_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Blocks of at least slotsPerBlock equally sized slots, one run of blocks per
+// slot size. Blocks are aligned to their power of two size, so a slot finds its
+// block's header by masking its address. Every block keeps its own free list
+// and count of slots in use, and is returned once none are, except the last one
+// of its size which is kept for the next allocation.
+class node_pool
+{
+public:
+    static constexpr size_t slotsPerBlock = 1024;
+
+    node_pool() = default;
+    node_pool(node_pool const&) = delete;
+    node_pool& operator=(node_pool const&) = delete;
+
+    ~node_pool()
+    {
+        for (auto& slots : m_bySize)
+        {
+            while (slots.pBlocks)
+            {
+                slots.release(slots.pBlocks);
+            }
+        }
+    }
+
+    void* allocate(size_t size)
+    {
+        return of(size).allocate();
+    }
+
+    void deallocate(void* p, size_t size)
+    {
+        of(size).deallocate(p);
+    }
+
+    // Bytes held in blocks, in use or not
+    size_t reserved_bytes() const
+    {
+        size_t result = 0;
+        for (auto const& slots : m_bySize)
+        {
+            result += slots.blockCount * slots.blockBytes;
+        }
+
+        return result;
+    }
+
+private:
+    struct alignas(std::max_align_t) block
+    {
+        // Blocks with a slot to spare are linked into their slot_pool's list
+        block* pPrev = nullptr;
+        block* pNext = nullptr;
+        bool isListed = false;
+
+        // All blocks of the slot_pool, to return them when the pool goes away
+        block* pPrevAll = nullptr;
+        block* pNextAll = nullptr;
+
+        // Free slots hold the link to the next free one, after them the block
+        // is carved further from pCarve
+        void* pFree = nullptr;
+        unsigned char* pCarve = nullptr;
+        size_t carveLeft = 0;
+        size_t live = 0;
+    };
+
+    struct slot_pool
+    {
+        void* allocate()
+        {
+            block* pBlock = pAvailable;
+            if (!pBlock)
+            {
+                pBlock = acquire();
+            }
+
+            void* pSlot;
+            if (pBlock->pFree)
+            {
+                pSlot = pBlock->pFree;
+                pBlock->pFree = *static_cast<void**>(pSlot);
+            } else {
+                pSlot = pBlock->pCarve;
+                pBlock->pCarve += slotSize;
+                pBlock->carveLeft--;
+            }
+
+            if (!pBlock->pFree && 0 == pBlock->carveLeft)
+            {
+                unlist(pBlock);
+            }
+
+            pBlock->live++;
+            return pSlot;
+        }
+
+        void deallocate(void* pSlot)
+        {
+            block* pBlock = reinterpret_cast<block*>(reinterpret_cast<uintptr_t>(pSlot) & ~(uintptr_t(blockBytes) - 1));
+            *static_cast<void**>(pSlot) = pBlock->pFree;
+            pBlock->pFree = pSlot;
+            pBlock->live--;
+
+            if (0 == pBlock->live && blockCount > 1)
+            {
+                if (pBlock->isListed)
+                {
+                    unlist(pBlock);
+                }
+
+                release(pBlock);
+            } else if (!pBlock->isListed) {
+                list(pBlock);
+            }
+        }
+
+        block* acquire()
+        {
+            block* pBlock = ::new (::operator new(blockBytes, std::align_val_t(blockBytes))) block;
+            pBlock->pCarve = reinterpret_cast<unsigned char*>(pBlock + 1);
+            pBlock->carveLeft = (blockBytes - sizeof(block)) / slotSize;
+            link(pBlock);
+            list(pBlock);
+            blockCount++;
+            return pBlock;
+        }
+
+        void release(block* pBlock)
+        {
+            if (pBlock->pPrevAll)
+            {
+                pBlock->pPrevAll->pNextAll = pBlock->pNextAll;
+            } else {
+                pBlocks = pBlock->pNextAll;
+            }
+
+            if (pBlock->pNextAll)
+            {
+                pBlock->pNextAll->pPrevAll = pBlock->pPrevAll;
+            }
+
+            blockCount--;
+            pBlock->~block();
+            ::operator delete(pBlock, std::align_val_t(blockBytes));
+        }
+
+        void list(block* pBlock)
+        {
+            pBlock->pPrev = nullptr;
+            pBlock->pNext = pAvailable;
+            if (pAvailable)
+            {
+                pAvailable->pPrev = pBlock;
+            }
+
+            pAvailable = pBlock;
+            pBlock->isListed = true;
+        }
+
+        void unlist(block* pBlock)
+        {
+            if (pBlock->pPrev)
+            {
+                pBlock->pPrev->pNext = pBlock->pNext;
+            } else {
+                pAvailable = pBlock->pNext;
+            }
+
+            if (pBlock->pNext)
+            {
+                pBlock->pNext->pPrev = pBlock->pPrev;
+            }
+
+            pBlock->isListed = false;
+        }
+
+        void link(block* pBlock)
+        {
+            pBlock->pNextAll = pBlocks;
+            if (pBlocks)
+            {
+                pBlocks->pPrevAll = pBlock;
+            }
+
+            pBlocks = pBlock;
+        }
+
+        size_t slotSize = 0;
+        size_t blockBytes = 0;
+        size_t blockCount = 0;
+        block* pAvailable = nullptr;
+        block* pBlocks = nullptr;
+    };
+
+    // Containers allocate one or two sizes, a linear search is enough
+    slot_pool& of(size_t size)
+    {
+        const size_t slotSize = (std::max(size, sizeof(void*)) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+        for (auto& slots : m_bySize)
+        {
+            if (slots.slotSize == slotSize)
+            {
+                return slots;
+            }
+        }
+
+        m_bySize.emplace_back();
+        slot_pool& slots = m_bySize.back();
+        slots.slotSize = slotSize;
+        slots.blockBytes = 1;
+        while (slots.blockBytes < sizeof(block) + slotsPerBlock * slotSize)
+        {
+            slots.blockBytes *= 2;
+        }
+
+        return slots;
+    }
+
+    std::vector<slot_pool> m_bySize;
+};
+
+// Allocator handing out single objects from a node_pool, for node based maps like
+// std::map<K, V, std::less<K>, pool_allocator<std::pair<const K, V>>>. Nodes
+// allocated one after another are next to each other in memory. Copies and
+// rebound copies share the pool, a default constructed allocator starts a new
+// one, which is returned when the last allocator sharing it goes away.
+template<typename T>
+class pool_allocator
+{
+public:
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    static constexpr size_t slotsPerBlock = node_pool::slotsPerBlock;
+
+    pool_allocator()
+        : m_pool(std::make_shared<node_pool>())
+    {}
+
+    template<typename U>
+    pool_allocator(pool_allocator<U> const& rhs)
+        : m_pool(rhs.m_pool)
+    {}
+
+    T* allocate(size_t n)
+    {
+        if (1 != n || alignof(T) > alignof(std::max_align_t))
+        {
+            return static_cast<T*>(::operator new(n * sizeof(T)));
+        }
+
+        return static_cast<T*>(m_pool->allocate(sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n)
+    {
+        if (1 != n || alignof(T) > alignof(std::max_align_t))
+        {
+            ::operator delete(p);
+            return;
+        }
+
+        m_pool->deallocate(p, sizeof(T));
+    }
+
+    size_t reserved_bytes() const
+    {
+        return m_pool->reserved_bytes();
+    }
+
+    template<typename U>
+    bool operator==(pool_allocator<U> const& rhs) const
+    {
+        return m_pool == rhs.m_pool;
+    }
+
+    template<typename U>
+    bool operator!=(pool_allocator<U> const& rhs) const
+    {
+        return m_pool != rhs.m_pool;
+    }
+
+private:
+    template<typename> friend class pool_allocator;
+
+    std::shared_ptr<node_pool> m_pool;
+};
+
+#endif // INTERVAL_MAP_POOL_ALLOCATOR_HPP
\ No newline at end of file
@@ -0,0 +1,417 @@
+/* Copyright (C) 2024, Valkai-Nmeth Bla-rs */
+
+#ifndef INTERVAL_MAP_RADIX_MAP_HPP
+#define INTERVAL_MAP_RADIX_MAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Ordered map implementing the part of the std::map interface interval_map uses,
+// for unsigned integral keys. The keys are indexed by a radix trie with one level
+// per byte which, like an adaptive radix tree, skips the levels where all keys
+// below share the byte and points right at the entry where a single key is below.
+// Finding the entry at or after a key takes at most 2 * sizeof(K) node steps
+// however the keys are distributed, clustered keys with long common prefixes
+// take less. The entries themselves live in a list in key order, which makes
+// iteration and stepping to neighbours O(1).
+template<typename K, typename V>
+class radix_map
+{
+    static_assert(std::is_integral_v<K> && std::is_unsigned_v<K>, "radix_map needs an unsigned integral key type");
+
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<const K, V>;
+    using size_type = size_t;
+
+private:
+    using entry_list = std::list<value_type>;
+
+public:
+    using iterator = typename entry_list::iterator;
+    using const_iterator = typename entry_list::const_iterator;
+    using reverse_iterator = typename entry_list::reverse_iterator;
+    using const_reverse_iterator = typename entry_list::const_reverse_iterator;
+
+    radix_map() = default;
+
+    radix_map(radix_map const& rhs)
+    {
+        for (auto const& entry : rhs.m_entries)
+        {
+            emplace_hint(end(), entry);
+        }
+    }
+
+    radix_map(radix_map&& rhs) noexcept
+    {
+        swap(rhs);
+    }
+
+    radix_map& operator=(radix_map rhs)
+    {
+        swap(rhs);
+        return *this;
+    }
+
+    iterator begin() { return m_entries.begin(); }
+    const_iterator begin() const { return m_entries.begin(); }
+    iterator end() { return m_entries.end(); }
+    const_iterator end() const { return m_entries.end(); }
+    reverse_iterator rbegin() { return m_entries.rbegin(); }
+    const_reverse_iterator rbegin() const { return m_entries.rbegin(); }
+    reverse_iterator rend() { return m_entries.rend(); }
+    const_reverse_iterator rend() const { return m_entries.rend(); }
+
+    bool empty() const
+    {
+        return m_entries.empty();
+    }
+
+    size_t size() const
+    {
+        return m_entries.size();
+    }
+
+    void clear()
+    {
+        m_root.reset();
+        m_entries.clear();
+    }
+
+    void swap(radix_map& rhs) noexcept
+    {
+        m_root.swap(rhs.m_root);
+        m_entries.swap(rhs.m_entries);
+    }
+
+    iterator lower_bound(K const& key)
+    {
+        return successor(key);
+    }
+
+    const_iterator lower_bound(K const& key) const
+    {
+        return const_cast<radix_map*>(this)->successor(key);
+    }
+
+    iterator upper_bound(K const& key)
+    {
+        return key == maxKey ? end() : successor(key + 1);
+    }
+
+    const_iterator upper_bound(K const& key) const
+    {
+        return const_cast<radix_map*>(this)->upper_bound(key);
+    }
+
+    // The hint is ignored, the trie is walked at most twice anyway
+    template<typename... Args>
+    iterator emplace_hint(const_iterator, Args&&... args)
+    {
+        value_type entry(std::forward<Args>(args)...);
+        const K key = entry.first;
+
+        iterator pos = successor(key);
+        if (end() != pos && !(key < pos->first))
+        {
+            return pos;
+        }
+
+        iterator it = m_entries.emplace(pos, std::move(entry));
+        if (!m_root)
+        {
+            m_root = std::make_unique<node>(key, 0);
+        }
+
+        node* pNode = m_root.get();
+        for (;;)
+        {
+            const unsigned digit = digitOf(key, pNode->depth);
+            if (!pNode->has(digit))
+            {
+                pNode->insert(digit, slot(it));
+                return it;
+            }
+
+            slot& child = pNode->at(digit);
+            const K childKey = child.inner ? child.inner->prefix : child.entry->first;
+            const unsigned childDepth = child.inner ? child.inner->depth : levels;
+
+            // Find where key leaves the digits skipped on the way to child
+            unsigned level = pNode->depth + 1;
+            while (level < childDepth && digitOf(key, level) == digitOf(childKey, level))
+            {
+                level++;
+            }
+
+            if (level < childDepth)
+            {
+                // Fork at the first different digit
+                auto fork = std::make_unique<node>(key, level);
+                fork->insert(digitOf(childKey, level), std::move(child));
+                fork->insert(digitOf(key, level), slot(it));
+                child = slot(std::move(fork));
+                return it;
+            }
+
+            pNode = child.inner.get();
+        }
+    }
+
+    iterator erase(const_iterator pos)
+    {
+        const K key = pos->first;
+
+        // Find the node holding the entry and its parent
+        node* parent = nullptr;
+        node* pNode = m_root.get();
+        for (;;)
+        {
+            slot& child = pNode->at(digitOf(key, pNode->depth));
+            if (!child.inner)
+            {
+                break;
+            }
+
+            parent = pNode;
+            pNode = child.inner.get();
+        }
+
+        pNode->remove(digitOf(key, pNode->depth));
+        if (parent && 1 == pNode->slots.size())
+        {
+            // A single child takes the place of its parent, which link owns
+            slot remaining = std::move(pNode->slots.front());
+            parent->at(digitOf(key, parent->depth)) = std::move(remaining);
+        } else if (!parent && pNode->empty()) {
+            m_root.reset();
+        }
+
+        return m_entries.erase(pos);
+    }
+
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        while (first != last)
+        {
+            first = erase(first);
+        }
+
+        return m_entries.erase(last, last);
+    }
+
+private:
+    static constexpr unsigned levels = sizeof(K);
+    static constexpr K maxKey = K(~K(0));
+
+    struct node;
+
+    // Either a node or, when only one key is below, the entry itself
+    struct slot
+    {
+        explicit slot(iterator entry)
+            : entry(entry)
+        {}
+
+        explicit slot(std::unique_ptr<node> pNode)
+            : inner(std::move(pNode))
+        {}
+
+        std::unique_ptr<node> inner;
+        iterator entry;
+    };
+
+    // 256 way node looking at digit depth of the keys. Nodes with a single child
+    // are left out, so a child may look at a deeper digit than depth + 1, the
+    // digits in between are the ones of prefix (any key below the node).
+    // Slots are kept densely in digit order and found by counting the set bits
+    // before the digit.
+    struct node
+    {
+        node(K prefix, unsigned depth)
+            : prefix(prefix)
+            , depth(depth)
+        {}
+
+        bool has(unsigned digit) const
+        {
+            return (bits[digit >> 6] >> (digit & 63)) & 1;
+        }
+
+        bool empty() const
+        {
+            return slots.empty();
+        }
+
+        slot& at(unsigned digit)
+        {
+            return slots[rank(digit)];
+        }
+
+        slot const& at(unsigned digit) const
+        {
+            return slots[rank(digit)];
+        }
+
+        void insert(unsigned digit, slot&& child)
+        {
+            slots.insert(slots.begin() + rank(digit), std::move(child));
+            bits[digit >> 6] |= uint64_t(1) << (digit & 63);
+        }
+
+        void remove(unsigned digit)
+        {
+            slots.erase(slots.begin() + rank(digit));
+            bits[digit >> 6] &= ~(uint64_t(1) << (digit & 63));
+        }
+
+        // Number of set digits before digit
+        size_t rank(unsigned digit) const
+        {
+            size_t result = 0;
+            for (unsigned word = 0; word < (digit >> 6); word++)
+            {
+                result += popCount(bits[word]);
+            }
+
+            const uint64_t below = (uint64_t(1) << (digit & 63)) - 1;
+            return result + popCount(bits[digit >> 6] & below);
+        }
+
+        // First set digit at or after digit, 256 if there is none
+        unsigned next(unsigned digit) const
+        {
+            for (unsigned word = digit >> 6; word < 4; word++)
+            {
+                const uint64_t candidates = word == (digit >> 6) ? bits[word] & (~uint64_t(0) << (digit & 63)) : bits[word];
+                if (candidates)
+                {
+                    return (word << 6) + lowestBit(candidates);
+                }
+            }
+
+            return 256;
+        }
+
+        uint64_t bits[4] = {};
+        K prefix;
+        unsigned depth;
+        std::vector<slot> slots;
+    };
+
+    static unsigned digitOf(K key, unsigned level)
+    {
+        return static_cast<unsigned>((key >> (8 * (levels - 1 - level))) & 0xFF);
+    }
+
+    static unsigned popCount(uint64_t word)
+    {
+#ifdef _MSC_VER
+        return static_cast<unsigned>(__popcnt64(word));
+#else
+        return static_cast<unsigned>(__builtin_popcountll(word));
+#endif
+    }
+
+    static unsigned lowestBit(uint64_t word)
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, word);
+        return static_cast<unsigned>(index);
+#else
+        return static_cast<unsigned>(__builtin_ctzll(word));
+#endif
+    }
+
+    // Smallest entry below child
+    static iterator leftmost(slot const& child)
+    {
+        slot const* pSlot = &child;
+        while (pSlot->inner)
+        {
+            pSlot = &pSlot->inner->slots.front();
+        }
+
+        return pSlot->entry;
+    }
+
+    // First entry with a key at or after key
+    iterator successor(K key)
+    {
+        if (!m_root)
+        {
+            return end();
+        }
+
+        // Follow key as far as it goes. Where key falls before everything below
+        // a slot that is the answer, otherwise step to the next digit on the
+        // deepest node that has one.
+        node const* path[levels];
+        unsigned pathSize = 0;
+        for (node const* pNode = m_root.get(); ; )
+        {
+            path[pathSize++] = pNode;
+            const unsigned digit = digitOf(key, pNode->depth);
+            if (!pNode->has(digit))
+            {
+                break;
+            }
+
+            slot const& child = pNode->at(digit);
+            if (!child.inner)
+            {
+                if (!(child.entry->first < key))
+                {
+                    return child.entry;
+                }
+
+                break;
+            }
+
+            // Compare the digits skipped on the way to the child
+            const unsigned shift = 8 * (levels - child.inner->depth);
+            if ((key >> shift) != (child.inner->prefix >> shift))
+            {
+                if ((key >> shift) < (child.inner->prefix >> shift))
+                {
+                    return leftmost(child);
+                }
+
+                break;
+            }
+
+            pNode = child.inner.get();
+        }
+
+        while (pathSize--)
+        {
+            node const* pNode = path[pathSize];
+            const unsigned digit = digitOf(key, pNode->depth);
+            const unsigned nextDigit = digit < 255 ? pNode->next(digit + 1) : 256;
+            if (nextDigit < 256)
+            {
+                return leftmost(pNode->at(nextDigit));
+            }
+        }
+
+        return end();
+    }
+
+    std::unique_ptr<node> m_root;
+    entry_list m_entries;
+};
+
+#endif // INTERVAL_MAP_RADIX_MAP_HPP
\ No newline at end of file
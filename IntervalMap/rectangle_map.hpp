@@ -0,0 +1,169 @@
+/* Copyright (C) 2024, Valkai-Nmeth Bla-rs */
+
+#ifndef INTERVAL_MAP_RECTANGLE_MAP_HPP
+#define INTERVAL_MAP_RECTANGLE_MAP_HPP
+
+#include "interval_map.hpp"
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <type_traits>
+
+// Two dimensional interval_map, painting rectangles [xBegin, xEnd) x [yBegin, yEnd)
+// with values, later ones over earlier ones. X is split by a segment tree over
+// the whole range of the integral type X, built as far as assigns reach. An
+// assign is stored on the O(log X) nodes whose ranges cover [xBegin, xEnd), in
+// each node's interval_map over Y, tagged with the number of the assign. A
+// look-up walks down to x and takes the newest tag found for y on the way.
+// Takes O(n log X) memory for n assigns instead of copying maps over Y per key.
+template<typename X, typename Y, typename V>
+class rectangle_map
+{
+    static_assert(std::is_integral_v<X>, "rectangle_map splits the range of an integral X");
+
+    using position = std::make_unsigned_t<X>;
+
+    struct stamped
+    {
+        uint64_t stamp;
+        V val;
+
+        bool operator==(stamped const& rhs) const
+        {
+            return stamp == rhs.stamp && val == rhs.val;
+        }
+    };
+
+    struct column : interval_map<Y, stamped>
+    {
+        column(V const& val)
+            : interval_map<Y, stamped>(stamped{ 0, val })
+        {}
+
+        bool empty() const
+        {
+            return this->m_map.empty();
+        }
+    };
+
+    struct node
+    {
+        node(V const& val)
+            : ys(val)
+        {}
+
+        column ys;
+        std::unique_ptr<node> children[2];
+    };
+
+public:
+    // constructor associates the whole plane with val
+    rectangle_map(V const& val)
+        : m_valBegin(val)
+        , m_root(std::make_unique<node>(val))
+    {}
+
+    // Assign value val to rectangle [xBegin, xEnd) x [yBegin, yEnd).
+    // Overwrite previous values in this rectangle.
+    void assign(X const& xBegin, X const& xEnd, Y const& yBegin, Y const& yEnd, V const& val)
+    {
+        if (!(xBegin < xEnd) || !(yBegin < yEnd))
+        {
+            return;
+        }
+
+        ++m_stamp;
+        paint(*m_root, 0, std::numeric_limits<position>::max(), positionOf(xBegin), positionOf(xEnd) - 1, yBegin, yEnd, stamped{ m_stamp, val });
+    }
+
+    // look-up of the value associated with point (x, y)
+    V const& at(X const& x, Y const& y) const
+    {
+        const position target = positionOf(x);
+        stamped const* pNewest = nullptr;
+        position low = 0;
+        position high = std::numeric_limits<position>::max();
+        for (node const* pNode = m_root.get(); pNode;)
+        {
+            if (!pNode->ys.empty())
+            {
+                stamped const& found = pNode->ys[y];
+                if (!pNewest || pNewest->stamp < found.stamp)
+                {
+                    pNewest = &found;
+                }
+            }
+
+            const position middle = low + (high - low) / 2;
+            if (target <= middle)
+            {
+                pNode = pNode->children[0].get();
+                high = middle;
+            } else {
+                pNode = pNode->children[1].get();
+                low = middle + 1;
+            }
+        }
+
+        return pNewest && pNewest->stamp ? pNewest->val : m_valBegin;
+    }
+
+    size_t node_count() const
+    {
+        return countNodes(m_root.get());
+    }
+
+private:
+    // Order preserving map of X onto its unsigned counterpart
+    static position positionOf(X x)
+    {
+        if constexpr (std::is_signed_v<X>)
+        {
+            return static_cast<position>(x) ^ (position(1) << (std::numeric_limits<position>::digits - 1));
+        } else {
+            return x;
+        }
+    }
+
+    // Paint [first, last] x [yBegin, yEnd) on the nodes under current, which covers [low, high]
+    void paint(node& current, position low, position high, position first, position last, Y const& yBegin, Y const& yEnd, stamped const& val)
+    {
+        if (first <= low && high <= last)
+        {
+            current.ys.assign(yBegin, yEnd, val);
+            return;
+        }
+
+        const position middle = low + (high - low) / 2;
+        if (first <= middle)
+        {
+            paint(child(current, 0), low, middle, first, last, yBegin, yEnd, val);
+        }
+
+        if (last > middle)
+        {
+            paint(child(current, 1), middle + 1, high, first, last, yBegin, yEnd, val);
+        }
+    }
+
+    node& child(node& parent, int side)
+    {
+        if (!parent.children[side])
+        {
+            parent.children[side] = std::make_unique<node>(m_valBegin);
+        }
+
+        return *parent.children[side];
+    }
+
+    static size_t countNodes(node const* pNode)
+    {
+        return pNode ? 1 + countNodes(pNode->children[0].get()) + countNodes(pNode->children[1].get()) : 0;
+    }
+
+    V m_valBegin;
+    uint64_t m_stamp = 0;
+    std::unique_ptr<node> m_root;
+};
+
+#endif // INTERVAL_MAP_RECTANGLE_MAP_HPP
\ No newline at end of file
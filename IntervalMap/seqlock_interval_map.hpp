@@ -0,0 +1,347 @@
+/* Copyright (C) 2024, Valkai-Nmeth Bla-rs */
+
+#ifndef INTERVAL_MAP_SEQLOCK_INTERVAL_MAP_HPP
+#define INTERVAL_MAP_SEQLOCK_INTERVAL_MAP_HPP
+
+#include "interval_map.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// interval_map for one writer thread and any number of reader threads, where
+// readers take no lock and write no shared memory. The boundaries are published
+// in chunks of up to chunkSize, found through an index of the chunks' first keys.
+// An assign rebuilds the chunks it touches off to the side, then swaps them into
+// the index, or swaps in a rebuilt index when their count changes, while a
+// sequence counter is odd. That window only covers storing the swapped pointers,
+// so readers, which search optimistically and retry when the counter was odd or
+// moved meanwhile, wait for O(changed chunks) stores at most.
+// K and V are copied in atomic words, so they must be trivially copyable and
+// small enough to be lock-free.
+template<typename K, typename V, typename Map = std::map<K, V>>
+class seqlock_interval_map
+{
+    static_assert(std::atomic<K>::is_always_lock_free && std::atomic<V>::is_always_lock_free, "seqlock_interval_map reads K and V as lock-free atomics");
+
+public:
+    static constexpr size_t chunkSize = 64;
+
+    // constructor associates whole range of K with val, the index starts with room for capacity chunks
+    seqlock_interval_map(V const& val, size_t capacity = 16)
+        : m_valBegin(val)
+        , m_writer(val)
+    {
+        m_indexes.push_back(std::make_unique<index>(std::max<size_t>(1, capacity)));
+        m_indexes.push_back(std::make_unique<index>(std::max<size_t>(1, capacity)));
+        m_published = m_indexes[0].get();
+        m_spare = m_indexes[1].get();
+        m_current.store(m_published, std::memory_order_release);
+    }
+
+    seqlock_interval_map(seqlock_interval_map const&) = delete;
+    seqlock_interval_map& operator=(seqlock_interval_map const&) = delete;
+
+    // Assign value val to interval [keyBegin, keyEnd), from the writer thread only
+    void assign(K const& keyBegin, K const& keyEnd, V const& val)
+    {
+        if (!(keyBegin < keyEnd))
+        {
+            return;
+        }
+
+        m_writer.assign(keyBegin, keyEnd, val);
+
+        // The chunks holding keys in [keyBegin, keyEnd], or the one the first new
+        // boundary goes to, get the writer's entries between their first keys
+        index& published = *m_published;
+        const size_t count = published.count.load(std::memory_order_relaxed);
+        size_t first = firstKeyUpperBound(published, count, keyBegin);
+        first = first > 0 ? first - 1 : 0;
+        size_t last = std::max(first + 1, firstKeyUpperBound(published, count, keyEnd));
+        last = std::min(last, count);
+
+        auto range = entriesOf(published, count, first, last);
+        size_t total = std::distance(range.first, range.second);
+
+        // Take a neighbour in when the chunks would get too thin
+        if (total < chunkSize / 4 && (first > 0 || last < count))
+        {
+            if (last < count)
+            {
+                last++;
+            } else {
+                first--;
+            }
+
+            range = entriesOf(published, count, first, last);
+            total = std::distance(range.first, range.second);
+        }
+
+        // Retired chunks and the spare index may be reused from here on. Readers
+        // still searching them started before they were retired, this orders the
+        // counter update retiring them before the writes, so those readers retry.
+        std::atomic_thread_fence(std::memory_order_release);
+
+        const size_t chunkCount = (total + chunkSize - 1) / chunkSize;
+        m_fresh.clear();
+        auto it = range.first;
+        for (size_t i = 0; i < chunkCount; i++)
+        {
+            chunk* pChunk = acquireChunk();
+            const size_t size = total * (i + 1) / chunkCount - total * i / chunkCount;
+            for (size_t j = 0; j < size; ++j, ++it)
+            {
+                pChunk->keys[j].store(it->first, std::memory_order_relaxed);
+                pChunk->values[j].store(it->second, std::memory_order_relaxed);
+            }
+
+            pChunk->size.store(size, std::memory_order_relaxed);
+            m_fresh.push_back(pChunk);
+        }
+
+        const size_t replaced = last - first;
+        if (chunkCount == replaced)
+        {
+            beginWrite();
+            for (size_t i = 0; i < chunkCount; i++)
+            {
+                retireChunk(published.chunks[first + i].load(std::memory_order_relaxed));
+                published.chunks[first + i].store(m_fresh[i], std::memory_order_relaxed);
+                published.firstKeys[first + i].store(m_fresh[i]->keys[0].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+            endWrite();
+            return;
+        }
+
+        // The chunks after the replaced ones move, build the index anew and swap it in
+        const size_t newCount = count - replaced + chunkCount;
+        if (m_spare->capacity < newCount)
+        {
+            m_indexes.push_back(std::make_unique<index>(2 * newCount));
+            m_spare = m_indexes.back().get();
+        }
+
+        index& spare = *m_spare;
+        size_t to = 0;
+        auto copy = [&](chunk* pChunk)
+        {
+            spare.chunks[to].store(pChunk, std::memory_order_relaxed);
+            spare.firstKeys[to].store(pChunk->keys[0].load(std::memory_order_relaxed), std::memory_order_relaxed);
+            to++;
+        };
+
+        for (size_t i = 0; i < first; i++)
+        {
+            copy(published.chunks[i].load(std::memory_order_relaxed));
+        }
+
+        for (chunk* pChunk : m_fresh)
+        {
+            copy(pChunk);
+        }
+
+        for (size_t i = last; i < count; i++)
+        {
+            copy(published.chunks[i].load(std::memory_order_relaxed));
+        }
+
+        spare.count.store(newCount, std::memory_order_relaxed);
+
+        beginWrite();
+        m_current.store(&spare, std::memory_order_relaxed);
+        endWrite();
+
+        for (size_t i = first; i < last; i++)
+        {
+            retireChunk(published.chunks[i].load(std::memory_order_relaxed));
+        }
+
+        std::swap(m_published, m_spare);
+    }
+
+    // look-up of the value associated with key, from any thread
+    V operator[](K const& key) const
+    {
+        for (;;)
+        {
+            const uint64_t sequence = m_sequence.load(std::memory_order_acquire);
+            if (sequence & 1)
+            {
+                relax();
+                continue;
+            }
+
+            // Searches stay within the arrays even if they change under us
+            index const& current = *m_current.load(std::memory_order_relaxed);
+            const size_t count = std::min(current.count.load(std::memory_order_relaxed), current.capacity);
+            const size_t position = firstKeyUpperBound(current, count, key);
+
+            V val = m_valBegin;
+            chunk const* pChunk = 0 == position ? nullptr : current.chunks[position - 1].load(std::memory_order_relaxed);
+            if (pChunk)
+            {
+                const size_t size = std::min(pChunk->size.load(std::memory_order_relaxed), chunkSize);
+                size_t index = 0;
+                for (size_t remaining = size; remaining > 0;)
+                {
+                    const size_t half = remaining / 2;
+                    if (key < pChunk->keys[index + half].load(std::memory_order_relaxed))
+                    {
+                        remaining = half;
+                    } else {
+                        index += half + 1;
+                        remaining -= half + 1;
+                    }
+                }
+
+                if (index > 0)
+                {
+                    val = pChunk->values[index - 1].load(std::memory_order_relaxed);
+                }
+            }
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (m_sequence.load(std::memory_order_relaxed) == sequence)
+            {
+                return val;
+            }
+        }
+    }
+
+    // Number of boundaries, from the writer thread
+    size_t size() const
+    {
+        return m_writer.entries().size();
+    }
+
+private:
+    struct writer_map : interval_map<K, V, Map>
+    {
+        writer_map(V const& val)
+            : interval_map<K, V, Map>(val)
+        {}
+
+        Map const& entries() const
+        {
+            return this->m_map;
+        }
+    };
+
+    // Chunks and indexes are never freed while the map lives, since readers may
+    // still be searching one the writer has replaced. Replaced chunks are reused.
+    struct chunk
+    {
+        std::atomic<size_t> size{ 0 };
+        std::atomic<K> keys[chunkSize];
+        std::atomic<V> values[chunkSize];
+    };
+
+    struct index
+    {
+        index(size_t capacity)
+            : capacity(capacity)
+            , firstKeys(new std::atomic<K>[capacity])
+            , chunks(new std::atomic<chunk*>[capacity])
+        {
+            for (size_t i = 0; i < capacity; i++)
+            {
+                chunks[i].store(nullptr, std::memory_order_relaxed);
+            }
+        }
+
+        const size_t capacity;
+        std::atomic<size_t> count{ 0 };
+        std::unique_ptr<std::atomic<K>[]> firstKeys;
+        std::unique_ptr<std::atomic<chunk*>[]> chunks;
+    };
+
+    static void relax()
+    {
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+        _mm_pause();
+#else
+        std::this_thread::yield();
+#endif
+    }
+
+    static size_t firstKeyUpperBound(index const& current, size_t count, K const& key)
+    {
+        size_t position = 0;
+        for (size_t remaining = count; remaining > 0;)
+        {
+            const size_t half = remaining / 2;
+            if (key < current.firstKeys[position + half].load(std::memory_order_relaxed))
+            {
+                remaining = half;
+            } else {
+                position += half + 1;
+                remaining -= half + 1;
+            }
+        }
+
+        return position;
+    }
+
+    // Writer's entries from the first key of chunk first up to the one of chunk last
+    auto entriesOf(index const& published, size_t count, size_t first, size_t last) const
+    {
+        Map const& entries = m_writer.entries();
+        auto begin = 0 == first ? entries.begin() : entries.lower_bound(published.firstKeys[first].load(std::memory_order_relaxed));
+        auto end = last >= count ? entries.end() : entries.lower_bound(published.firstKeys[last].load(std::memory_order_relaxed));
+        return std::make_pair(begin, end);
+    }
+
+    chunk* acquireChunk()
+    {
+        if (m_freeChunks.empty())
+        {
+            m_chunks.push_back(std::make_unique<chunk>());
+            return m_chunks.back().get();
+        }
+
+        chunk* pChunk = m_freeChunks.back();
+        m_freeChunks.pop_back();
+        return pChunk;
+    }
+
+    void retireChunk(chunk* pChunk)
+    {
+        m_freeChunks.push_back(pChunk);
+    }
+
+    void beginWrite()
+    {
+        m_sequence.store(m_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void endWrite()
+    {
+        m_sequence.store(m_sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    const V m_valBegin;
+    writer_map m_writer;
+    std::vector<std::unique_ptr<chunk>> m_chunks;
+    std::vector<chunk*> m_freeChunks;
+    std::vector<chunk*> m_fresh;
+    std::vector<std::unique_ptr<index>> m_indexes;
+    index* m_published = nullptr;
+    index* m_spare = nullptr;
+
+    // Readers only load these, kept apart from the writer's own members
+    alignas(64) std::atomic<uint64_t> m_sequence{ 0 };
+    std::atomic<index*> m_current{ nullptr };
+};
+
+#endif // INTERVAL_MAP_SEQLOCK_INTERVAL_MAP_HPP
\ No newline at end of file
@@ -0,0 +1,363 @@
+/* Copyright (C) 2024, Valkai-Nmeth Bla-rs */
+
+#ifndef INTERVAL_MAP_SMALL_MAP_HPP
+#define INTERVAL_MAP_SMALL_MAP_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Ordered map implementing the part of the std::map interface interval_map uses,
+// keeping up to N entries sorted inline in the object. It spills to a heap
+// allocated std::map once it grows past N entries and stays there until clear().
+template<typename K, typename V, size_t N = 8>
+class small_map
+{
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<const K, V>;
+    using size_type = size_t;
+
+private:
+    using heap_map = std::map<K, V>;
+
+    template<bool IsConst>
+    class basic_iterator
+    {
+        using owner_type = std::conditional_t<IsConst, small_map const, small_map>;
+        using map_iterator = std::conditional_t<IsConst, typename heap_map::const_iterator, typename heap_map::iterator>;
+
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = typename small_map::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<IsConst, value_type const*, value_type*>;
+        using reference = std::conditional_t<IsConst, value_type const&, value_type&>;
+
+        basic_iterator() = default;
+
+        basic_iterator(owner_type* pOwner, size_t index)
+            : m_owner(pOwner)
+            , m_index(index)
+        {}
+
+        basic_iterator(owner_type* pOwner, map_iterator mapIt)
+            : m_owner(pOwner)
+            , m_mapIt(mapIt)
+        {}
+
+        // iterator converts to const_iterator
+        template<bool WasConst, typename = std::enable_if_t<IsConst && !WasConst>>
+        basic_iterator(basic_iterator<WasConst> const& rhs)
+            : m_owner(rhs.m_owner)
+            , m_index(rhs.m_index)
+            , m_mapIt(rhs.m_mapIt)
+        {}
+
+        reference operator*() const
+        {
+            return m_owner->m_heap ? *m_mapIt : m_owner->data()[m_index];
+        }
+
+        pointer operator->() const
+        {
+            return &**this;
+        }
+
+        basic_iterator& operator++()
+        {
+            if (m_owner->m_heap)
+            {
+                ++m_mapIt;
+            } else {
+                ++m_index;
+            }
+
+            return *this;
+        }
+
+        basic_iterator operator++(int)
+        {
+            basic_iterator result = *this;
+            ++*this;
+            return result;
+        }
+
+        basic_iterator& operator--()
+        {
+            if (m_owner->m_heap)
+            {
+                --m_mapIt;
+            } else {
+                --m_index;
+            }
+
+            return *this;
+        }
+
+        basic_iterator operator--(int)
+        {
+            basic_iterator result = *this;
+            --*this;
+            return result;
+        }
+
+        bool operator==(basic_iterator const& rhs) const
+        {
+            return m_owner->m_heap ? m_mapIt == rhs.m_mapIt : m_index == rhs.m_index;
+        }
+
+        bool operator!=(basic_iterator const& rhs) const
+        {
+            return !(*this == rhs);
+        }
+
+    private:
+        friend class small_map;
+        template<bool> friend class basic_iterator;
+
+        owner_type* m_owner = nullptr;
+        size_t m_index = 0;
+        map_iterator m_mapIt{};
+    };
+
+public:
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    small_map() = default;
+
+    small_map(small_map const& rhs)
+    {
+        *this = rhs;
+    }
+
+    small_map(small_map&& rhs) noexcept
+    {
+        *this = std::move(rhs);
+    }
+
+    small_map& operator=(small_map const& rhs)
+    {
+        if (this != &rhs)
+        {
+            clear();
+            if (rhs.m_heap)
+            {
+                m_heap = std::make_unique<heap_map>(*rhs.m_heap);
+            } else {
+                std::uninitialized_copy(rhs.data(), rhs.data() + rhs.m_size, data());
+                m_size = rhs.m_size;
+            }
+        }
+
+        return *this;
+    }
+
+    small_map& operator=(small_map&& rhs) noexcept
+    {
+        if (this != &rhs)
+        {
+            clear();
+            if (rhs.m_heap)
+            {
+                m_heap = std::move(rhs.m_heap);
+            } else {
+                std::uninitialized_copy(std::make_move_iterator(rhs.data()), std::make_move_iterator(rhs.data() + rhs.m_size), data());
+                m_size = rhs.m_size;
+                rhs.clear();
+            }
+        }
+
+        return *this;
+    }
+
+    ~small_map()
+    {
+        clear();
+    }
+
+    iterator begin() { return m_heap ? iterator(this, m_heap->begin()) : iterator(this, size_t(0)); }
+    const_iterator begin() const { return m_heap ? const_iterator(this, m_heap->cbegin()) : const_iterator(this, size_t(0)); }
+    iterator end() { return m_heap ? iterator(this, m_heap->end()) : iterator(this, m_size); }
+    const_iterator end() const { return m_heap ? const_iterator(this, m_heap->cend()) : const_iterator(this, m_size); }
+    reverse_iterator rbegin() { return reverse_iterator(end()); }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+    reverse_iterator rend() { return reverse_iterator(begin()); }
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+    bool empty() const
+    {
+        return 0 == size();
+    }
+
+    size_t size() const
+    {
+        return m_heap ? m_heap->size() : m_size;
+    }
+
+    // Whether the entries are in the heap allocated std::map
+    bool spilled() const
+    {
+        return !!m_heap;
+    }
+
+    void clear()
+    {
+        m_heap.reset();
+        std::destroy(data(), data() + m_size);
+        m_size = 0;
+    }
+
+    void swap(small_map& rhs)
+    {
+        small_map tmp(std::move(rhs));
+        rhs = std::move(*this);
+        *this = std::move(tmp);
+    }
+
+    iterator lower_bound(K const& key) { return m_heap ? iterator(this, m_heap->lower_bound(key)) : iterator(this, lowerBound(key)); }
+    const_iterator lower_bound(K const& key) const { return m_heap ? const_iterator(this, m_heap->lower_bound(key)) : const_iterator(this, lowerBound(key)); }
+    iterator upper_bound(K const& key) { return m_heap ? iterator(this, m_heap->upper_bound(key)) : iterator(this, upperBound(key)); }
+    const_iterator upper_bound(K const& key) const { return m_heap ? const_iterator(this, m_heap->upper_bound(key)) : const_iterator(this, upperBound(key)); }
+
+    // The hint is only used once spilled, inline entries are few enough to search
+    template<typename... Args>
+    iterator emplace_hint(const_iterator hint, Args&&... args)
+    {
+        if (m_heap)
+        {
+            return iterator(this, m_heap->emplace_hint(hint.m_mapIt, std::forward<Args>(args)...));
+        }
+
+        value_type entry(std::forward<Args>(args)...);
+        const size_t index = lowerBound(entry.first);
+        if (index < m_size && !(entry.first < data()[index].first))
+        {
+            return iterator(this, index);
+        }
+
+        if (N == m_size)
+        {
+            spill();
+            return iterator(this, m_heap->emplace_hint(m_heap->end(), std::move(entry)));
+        }
+
+        // Shift the entries after index to make room
+        value_type* pData = data();
+        if (index < m_size)
+        {
+            ::new (static_cast<void*>(pData + m_size)) value_type(std::move(pData[m_size - 1]));
+            for (size_t i = m_size - 1; i > index; i--)
+            {
+                std::destroy_at(pData + i);
+                ::new (static_cast<void*>(pData + i)) value_type(std::move(pData[i - 1]));
+            }
+
+            std::destroy_at(pData + index);
+        }
+
+        ::new (static_cast<void*>(pData + index)) value_type(std::move(entry));
+        m_size++;
+        return iterator(this, index);
+    }
+
+    iterator erase(const_iterator pos)
+    {
+        if (m_heap)
+        {
+            return iterator(this, m_heap->erase(pos.m_mapIt));
+        }
+
+        // Shift the entries after pos over it
+        value_type* pData = data();
+        for (size_t i = pos.m_index; i + 1 < m_size; i++)
+        {
+            std::destroy_at(pData + i);
+            ::new (static_cast<void*>(pData + i)) value_type(std::move(pData[i + 1]));
+        }
+
+        std::destroy_at(pData + --m_size);
+        return iterator(this, pos.m_index);
+    }
+
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        if (m_heap)
+        {
+            return iterator(this, m_heap->erase(first.m_mapIt, last.m_mapIt));
+        }
+
+        const size_t count = last.m_index - first.m_index;
+        value_type* pData = data();
+        for (size_t i = first.m_index; i + count < m_size; i++)
+        {
+            std::destroy_at(pData + i);
+            ::new (static_cast<void*>(pData + i)) value_type(std::move(pData[i + count]));
+        }
+
+        std::destroy(pData + m_size - count, pData + m_size);
+        m_size -= count;
+        return iterator(this, first.m_index);
+    }
+
+private:
+    value_type* data()
+    {
+        return std::launder(reinterpret_cast<value_type*>(m_storage));
+    }
+
+    value_type const* data() const
+    {
+        return std::launder(reinterpret_cast<value_type const*>(m_storage));
+    }
+
+    size_t lowerBound(K const& key) const
+    {
+        size_t index = 0;
+        while (index < m_size && data()[index].first < key)
+        {
+            index++;
+        }
+
+        return index;
+    }
+
+    size_t upperBound(K const& key) const
+    {
+        size_t index = 0;
+        while (index < m_size && !(key < data()[index].first))
+        {
+            index++;
+        }
+
+        return index;
+    }
+
+    void spill()
+    {
+        auto heap = std::make_unique<heap_map>();
+        for (size_t i = 0; i < m_size; i++)
+        {
+            heap->emplace_hint(heap->end(), std::move(data()[i]));
+        }
+
+        std::destroy(data(), data() + m_size);
+        m_size = 0;
+        m_heap = std::move(heap);
+    }
+
+    alignas(value_type) unsigned char m_storage[N * sizeof(value_type)];
+    size_t m_size = 0;
+    std::unique_ptr<heap_map> m_heap;
+};
+
+#endif // INTERVAL_MAP_SMALL_MAP_HPP
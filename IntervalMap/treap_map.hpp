@@ -0,0 +1,560 @@
+/* Copyright (C) 2024, Valkai-Nmeth Bla-rs */
+
+#ifndef INTERVAL_MAP_TREAP_MAP_HPP
+#define INTERVAL_MAP_TREAP_MAP_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+
+// Ordered map implementing the part of the std::map interface interval_map uses,
+// on top of a treap. Besides the usual operations it can split at a key and join
+// with a map holding greater keys in expected O(log n). Every map, copies
+// included, draws its priorities from a sequence seeded of its own, so an
+// insertion order unlucky for one map is not unlucky for all of them.
+template<typename K, typename V>
+class treap_map
+{
+    struct node
+    {
+        template<typename... Args>
+        node(Args&&... args)
+            : value(std::forward<Args>(args)...)
+        {}
+
+        std::pair<K, V> value;
+        node* left = nullptr;
+        node* right = nullptr;
+        node* parent = nullptr;
+        uint32_t priority = 0;
+        size_t size = 1;
+    };
+
+    template<bool IsConst>
+    class basic_iterator
+    {
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = std::pair<K, V>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<IsConst, value_type const*, value_type*>;
+        using reference = std::conditional_t<IsConst, value_type const&, value_type&>;
+
+        basic_iterator() = default;
+
+        basic_iterator(node* pNode, treap_map const* pMap)
+            : m_node(pNode)
+            , m_map(pMap)
+        {}
+
+        // iterator converts to const_iterator
+        template<bool WasConst, typename = std::enable_if_t<IsConst && !WasConst>>
+        basic_iterator(basic_iterator<WasConst> const& rhs)
+            : m_node(rhs.m_node)
+            , m_map(rhs.m_map)
+        {}
+
+        reference operator*() const
+        {
+            return m_node->value;
+        }
+
+        pointer operator->() const
+        {
+            return &m_node->value;
+        }
+
+        basic_iterator& operator++()
+        {
+            if (m_node->right)
+            {
+                m_node = leftmost(m_node->right);
+            } else {
+                node* child = m_node;
+                m_node = m_node->parent;
+                while (m_node && m_node->right == child)
+                {
+                    child = m_node;
+                    m_node = m_node->parent;
+                }
+            }
+
+            return *this;
+        }
+
+        basic_iterator operator++(int)
+        {
+            basic_iterator result = *this;
+            ++*this;
+            return result;
+        }
+
+        basic_iterator& operator--()
+        {
+            if (!m_node)
+            {
+                // end() steps back to the greatest key
+                m_node = rightmost(m_map->m_root);
+            } else if (m_node->left) {
+                m_node = rightmost(m_node->left);
+            } else {
+                node* child = m_node;
+                m_node = m_node->parent;
+                while (m_node && m_node->left == child)
+                {
+                    child = m_node;
+                    m_node = m_node->parent;
+                }
+            }
+
+            return *this;
+        }
+
+        basic_iterator operator--(int)
+        {
+            basic_iterator result = *this;
+            --*this;
+            return result;
+        }
+
+        bool operator==(basic_iterator const& rhs) const
+        {
+            return m_node == rhs.m_node;
+        }
+
+        bool operator!=(basic_iterator const& rhs) const
+        {
+            return m_node != rhs.m_node;
+        }
+
+    private:
+        friend class treap_map;
+        template<bool> friend class basic_iterator;
+
+        node* m_node = nullptr;
+        treap_map const* m_map = nullptr;
+    };
+
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<K, V>;
+    using size_type = size_t;
+    using iterator = basic_iterator<false>;
+    using const_iterator = basic_iterator<true>;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+    // Entry taken out of the map with extract(), can be changed and inserted again
+    class node_type
+    {
+    public:
+        node_type() = default;
+
+        node_type(node_type&& rhs) noexcept
+            : m_node(rhs.m_node)
+        {
+            rhs.m_node = nullptr;
+        }
+
+        node_type& operator=(node_type&& rhs) noexcept
+        {
+            std::swap(m_node, rhs.m_node);
+            return *this;
+        }
+
+        ~node_type()
+        {
+            delete m_node;
+        }
+
+        bool empty() const
+        {
+            return !m_node;
+        }
+
+        K& key() const
+        {
+            return m_node->value.first;
+        }
+
+        V& mapped() const
+        {
+            return m_node->value.second;
+        }
+
+    private:
+        friend class treap_map;
+
+        explicit node_type(node* pNode)
+            : m_node(pNode)
+        {}
+
+        node* m_node = nullptr;
+    };
+
+    treap_map() = default;
+
+    treap_map(treap_map const& rhs)
+        : m_root(clone(rhs.m_root, nullptr))
+    {}
+
+    treap_map(treap_map&& rhs) noexcept
+    {
+        swap(rhs);
+    }
+
+    treap_map& operator=(treap_map rhs)
+    {
+        swap(rhs);
+        return *this;
+    }
+
+    ~treap_map()
+    {
+        clear();
+    }
+
+    iterator begin() { return iterator(leftmost(m_root), this); }
+    const_iterator begin() const { return const_iterator(leftmost(m_root), this); }
+    iterator end() { return iterator(nullptr, this); }
+    const_iterator end() const { return const_iterator(nullptr, this); }
+    reverse_iterator rbegin() { return reverse_iterator(end()); }
+    const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+    reverse_iterator rend() { return reverse_iterator(begin()); }
+    const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+    bool empty() const
+    {
+        return !m_root;
+    }
+
+    size_t size() const
+    {
+        return sizeOf(m_root);
+    }
+
+    void clear()
+    {
+        destroy(m_root);
+        m_root = nullptr;
+    }
+
+    void swap(treap_map& rhs) noexcept
+    {
+        std::swap(m_root, rhs.m_root);
+        std::swap(m_random, rhs.m_random);
+    }
+
+    iterator lower_bound(K const& key) { return iterator(lowerBound(key), this); }
+    const_iterator lower_bound(K const& key) const { return const_iterator(lowerBound(key), this); }
+    iterator upper_bound(K const& key) { return iterator(upperBound(key), this); }
+    const_iterator upper_bound(K const& key) const { return const_iterator(upperBound(key), this); }
+
+    // The hint is ignored, insertion is expected O(log n) anyway
+    template<typename... Args>
+    iterator emplace_hint(const_iterator, Args&&... args)
+    {
+        return insertNode(new node(std::forward<Args>(args)...));
+    }
+
+    iterator insert(const_iterator, node_type&& nh)
+    {
+        node* pNode = nh.m_node;
+        nh.m_node = nullptr;
+        return insertNode(pNode);
+    }
+
+    node_type extract(const_iterator pos)
+    {
+        node* pNode = pos.m_node;
+        unlink(pNode);
+        return node_type(pNode);
+    }
+
+    iterator erase(const_iterator pos)
+    {
+        iterator next(pos.m_node, this);
+        ++next;
+        extract(pos);
+        return next;
+    }
+
+    // Cut the range out with two splits and tear it down at once, expected
+    // O(log n) besides deleting the nodes
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        if (first == last)
+        {
+            return iterator(last.m_node, this);
+        }
+
+        node* left;
+        node* middle;
+        node* right = nullptr;
+        splitNode(m_root, first.m_node->value.first, left, middle);
+        if (last.m_node)
+        {
+            splitNode(middle, last.m_node->value.first, middle, right);
+        }
+
+        destroy(middle);
+        m_root = mergeNodes(left, right);
+        detach(m_root);
+        return iterator(last.m_node, this);
+    }
+
+    // Move all entries with keys at or after key to right, which must be empty
+    void split(K const& key, treap_map& right)
+    {
+        right.clear();
+        splitNode(m_root, key, m_root, right.m_root);
+        detach(m_root);
+        detach(right.m_root);
+    }
+
+    // Move all entries of right here, they must all be after the ones in this map
+    void join(treap_map& right)
+    {
+        m_root = mergeNodes(m_root, right.m_root);
+        detach(m_root);
+        right.m_root = nullptr;
+    }
+
+private:
+    static node* leftmost(node* pNode)
+    {
+        while (pNode && pNode->left)
+        {
+            pNode = pNode->left;
+        }
+
+        return pNode;
+    }
+
+    static node* rightmost(node* pNode)
+    {
+        while (pNode && pNode->right)
+        {
+            pNode = pNode->right;
+        }
+
+        return pNode;
+    }
+
+    // Tear down without recursion, rotating left children up
+    static void destroy(node* pNode)
+    {
+        while (pNode)
+        {
+            if (pNode->left)
+            {
+                node* left = pNode->left;
+                pNode->left = left->right;
+                left->right = pNode;
+                pNode = left;
+            } else {
+                node* right = pNode->right;
+                delete pNode;
+                pNode = right;
+            }
+        }
+    }
+
+    static size_t sizeOf(node* pNode)
+    {
+        return pNode ? pNode->size : 0;
+    }
+
+    static void detach(node* pNode)
+    {
+        if (pNode)
+        {
+            pNode->parent = nullptr;
+        }
+    }
+
+    // Recompute size and point the children back at the node
+    static void update(node* pNode)
+    {
+        pNode->size = 1 + sizeOf(pNode->left) + sizeOf(pNode->right);
+        if (pNode->left)
+        {
+            pNode->left->parent = pNode;
+        }
+
+        if (pNode->right)
+        {
+            pNode->right->parent = pNode;
+        }
+    }
+
+    // Split into keys before key and keys at or after it, roots' parents are stale
+    static void splitNode(node* pNode, K const& key, node*& left, node*& right)
+    {
+        if (!pNode)
+        {
+            left = right = nullptr;
+            return;
+        }
+
+        if (pNode->value.first < key)
+        {
+            splitNode(pNode->right, key, pNode->right, right);
+            left = pNode;
+        } else {
+            splitNode(pNode->left, key, left, pNode->left);
+            right = pNode;
+        }
+
+        update(pNode);
+    }
+
+    // All keys in left must be before the ones in right, root's parent is stale
+    static node* mergeNodes(node* left, node* right)
+    {
+        if (!left || !right)
+        {
+            return left ? left : right;
+        }
+
+        if (left->priority > right->priority)
+        {
+            left->right = mergeNodes(left->right, right);
+            update(left);
+            return left;
+        }
+
+        right->left = mergeNodes(left, right->left);
+        update(right);
+        return right;
+    }
+
+    static node* clone(node* pNode, node* parent)
+    {
+        if (!pNode)
+        {
+            return nullptr;
+        }
+
+        node* pCopy = new node(pNode->value);
+        pCopy->priority = pNode->priority;
+        pCopy->size = pNode->size;
+        pCopy->parent = parent;
+        pCopy->left = clone(pNode->left, pCopy);
+        pCopy->right = clone(pNode->right, pCopy);
+        return pCopy;
+    }
+
+    node* lowerBound(K const& key) const
+    {
+        node* result = nullptr;
+        for (node* pNode = m_root; pNode;)
+        {
+            if (pNode->value.first < key)
+            {
+                pNode = pNode->right;
+            } else {
+                result = pNode;
+                pNode = pNode->left;
+            }
+        }
+
+        return result;
+    }
+
+    node* upperBound(K const& key) const
+    {
+        node* result = nullptr;
+        for (node* pNode = m_root; pNode;)
+        {
+            if (key < pNode->value.first)
+            {
+                result = pNode;
+                pNode = pNode->left;
+            } else {
+                pNode = pNode->right;
+            }
+        }
+
+        return result;
+    }
+
+    iterator insertNode(node* pNode)
+    {
+        node* left;
+        node* right;
+        splitNode(m_root, pNode->value.first, left, right);
+
+        node* first = leftmost(right);
+        if (first && !(pNode->value.first < first->value.first))
+        {
+            // Key is already present, keep the map as it was
+            delete pNode;
+            m_root = mergeNodes(left, right);
+            detach(m_root);
+            return iterator(first, this);
+        }
+
+        // xorshift32
+        m_random ^= m_random << 13;
+        m_random ^= m_random >> 17;
+        m_random ^= m_random << 5;
+
+        pNode->priority = m_random;
+        pNode->left = pNode->right = pNode->parent = nullptr;
+        pNode->size = 1;
+        m_root = mergeNodes(mergeNodes(left, pNode), right);
+        detach(m_root);
+        return iterator(pNode, this);
+    }
+
+    void unlink(node* pNode)
+    {
+        node* parent = pNode->parent;
+        node* replacement = mergeNodes(pNode->left, pNode->right);
+        if (replacement)
+        {
+            replacement->parent = parent;
+        }
+
+        if (!parent)
+        {
+            m_root = replacement;
+        } else if (parent->left == pNode) {
+            parent->left = replacement;
+        } else {
+            parent->right = replacement;
+        }
+
+        for (; parent; parent = parent->parent)
+        {
+            parent->size--;
+        }
+
+        pNode->left = pNode->right = pNode->parent = nullptr;
+        pNode->size = 1;
+    }
+
+    // Mix the address of the map with the number of maps seeded so far
+    static uint32_t seed(void const* pMap)
+    {
+        static std::atomic<uint64_t> s_seeded{ 0 };
+        uint64_t mixed = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(pMap)) ^ (s_seeded.fetch_add(1, std::memory_order_relaxed) * 0x9e3779b97f4a7c15ull);
+        mixed ^= mixed >> 33;
+        mixed *= 0xff51afd7ed558ccdull;
+        mixed ^= mixed >> 33;
+
+        // xorshift32 would be stuck at 0
+        const uint32_t result = static_cast<uint32_t>(mixed);
+        return result ? result : 2463534242u;
+    }
+
+    node* m_root = nullptr;
+    uint32_t m_random = seed(this);
+};
+
+#endif // INTERVAL_MAP_TREAP_MAP_HPP
@@ -0,0 +1,226 @@
+/* Copyright (C) 2024, Valkai-Nmeth Bla-rs */
+
+#ifndef INTERVAL_MAP_VERSIONED_INTERVAL_MAP_HPP
+#define INTERVAL_MAP_VERSIONED_INTERVAL_MAP_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// interval_map keeping every version, answering what value a key had after any
+// earlier assign. The boundaries are in a persistent treap: an assign copies
+// only the nodes on the paths it changes and shares the rest with the previous
+// version, so the space grows by O(log n) nodes per assign instead of a copy of
+// the whole map. Nodes are never freed and live in one arena, linked by index.
+template<typename K, typename V>
+class versioned_interval_map
+{
+public:
+    // constructor associates whole range of K with val, this is version 0
+    versioned_interval_map(V const& val)
+        : m_valBegin(val)
+        , m_roots(1, nil)
+    {}
+
+    // Assign value val to interval [keyBegin, keyEnd) in a new version.
+    // Overwrite previous values in this interval. Returns the new version.
+    size_t assign(K const& keyBegin, K const& keyEnd, V const& val)
+    {
+        index_type root = m_roots.back();
+        if (!(keyBegin < keyEnd))
+        {
+            m_roots.push_back(root);
+            return version();
+        }
+
+        m_firstNewNode = m_nodes.size();
+
+        // Entries from keyBegin up to and including keyEnd are replaced by at
+        // most one at keyBegin and one at keyEnd
+        const V valueBefore = valueBeforeKey(root, keyBegin);
+        const V valueAtEnd = find(root, keyEnd);
+
+        index_type before;
+        index_type rest;
+        index_type replaced;
+        index_type after;
+        split(root, keyBegin, false, before, rest);
+        split(rest, keyEnd, true, replaced, after);
+
+        index_type middle = nil;
+        if (!(val == valueBefore))
+        {
+            middle = create(keyBegin, val);
+        }
+
+        if (!(val == valueAtEnd))
+        {
+            middle = merge(middle, create(keyEnd, valueAtEnd));
+        }
+
+        m_roots.push_back(merge(merge(before, middle), after));
+        return version();
+    }
+
+    // look-up of the value associated with key in the latest version
+    V const& operator[](K const& key) const
+    {
+        return find(m_roots.back(), key);
+    }
+
+    // look-up of the value associated with key right after version was made
+    V const& at(K const& key, size_t version) const
+    {
+        assert(version < m_roots.size());
+        return find(m_roots[version], key);
+    }
+
+    // Latest version, the number of assigns so far
+    size_t version() const
+    {
+        return m_roots.size() - 1;
+    }
+
+    // Nodes held for all the versions together
+    size_t node_count() const
+    {
+        return m_nodes.size();
+    }
+
+private:
+    using index_type = uint32_t;
+    static constexpr index_type nil = ~index_type(0);
+
+    struct node
+    {
+        node(K const& key, V const& value, uint32_t priority)
+            : key(key)
+            , value(value)
+            , priority(priority)
+        {}
+
+        K key;
+        V value;
+        uint32_t priority;
+        index_type left = nil;
+        index_type right = nil;
+    };
+
+    index_type create(K const& key, V const& value)
+    {
+        // xorshift32
+        m_random ^= m_random << 13;
+        m_random ^= m_random >> 17;
+        m_random ^= m_random << 5;
+
+        m_nodes.emplace_back(key, value, m_random);
+        assert(m_nodes.size() < nil);
+        return static_cast<index_type>(m_nodes.size() - 1);
+    }
+
+    // Nodes of earlier versions are immutable, changing one means changing a copy
+    index_type copy(index_type index)
+    {
+        if (index >= m_firstNewNode)
+        {
+            return index;
+        }
+
+        m_nodes.push_back(m_nodes[index]);
+        assert(m_nodes.size() < nil);
+        return static_cast<index_type>(m_nodes.size() - 1);
+    }
+
+    V const& find(index_type index, K const& key) const
+    {
+        V const* result = &m_valBegin;
+        while (nil != index)
+        {
+            node const& current = m_nodes[index];
+            if (key < current.key)
+            {
+                index = current.left;
+            } else {
+                result = &current.value;
+                index = current.right;
+            }
+        }
+
+        return *result;
+    }
+
+    V const& valueBeforeKey(index_type index, K const& key) const
+    {
+        V const* result = &m_valBegin;
+        while (nil != index)
+        {
+            node const& current = m_nodes[index];
+            if (current.key < key)
+            {
+                result = &current.value;
+                index = current.right;
+            } else {
+                index = current.left;
+            }
+        }
+
+        return *result;
+    }
+
+    // Split into keys before key (or up to and including it) and the rest,
+    // copying the nodes on the path
+    void split(index_type index, K const& key, bool includeKey, index_type& left, index_type& right)
+    {
+        if (nil == index)
+        {
+            left = right = nil;
+            return;
+        }
+
+        const bool goesLeft = includeKey ? !(key < m_nodes[index].key) : m_nodes[index].key < key;
+        index = copy(index);
+        if (goesLeft)
+        {
+            index_type rightOfRight;
+            split(m_nodes[index].right, key, includeKey, rightOfRight, right);
+            m_nodes[index].right = rightOfRight;
+            left = index;
+        } else {
+            index_type leftOfLeft;
+            split(m_nodes[index].left, key, includeKey, left, leftOfLeft);
+            m_nodes[index].left = leftOfLeft;
+            right = index;
+        }
+    }
+
+    // All keys in left must be before the ones in right
+    index_type merge(index_type left, index_type right)
+    {
+        if (nil == left || nil == right)
+        {
+            return nil == left ? right : left;
+        }
+
+        if (m_nodes[left].priority > m_nodes[right].priority)
+        {
+            const index_type merged = merge(m_nodes[left].right, right);
+            left = copy(left);
+            m_nodes[left].right = merged;
+            return left;
+        }
+
+        const index_type merged = merge(left, m_nodes[right].left);
+        right = copy(right);
+        m_nodes[right].left = merged;
+        return right;
+    }
+
+    V m_valBegin;
+    std::vector<node> m_nodes;
+    std::vector<index_type> m_roots;
+    size_t m_firstNewNode = 0;
+    uint32_t m_random = 2463534242u;
+};
+
+#endif // INTERVAL_MAP_VERSIONED_INTERVAL_MAP_HPP
\ No newline at end of file
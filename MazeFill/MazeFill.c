@@ -2,6 +2,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 typedef struct Neighbours
 {
@@ -25,9 +26,116 @@ typedef struct Point2D {
 	int y;
 } Point2D;
 
-void Fill(const Point2D* pPoint, unsigned char* pData, const int N, const int M)
+// Horizontal run of cells [xLeft, xRight] in row y, whose neighbours in the rows
+// above and below are still to be scanned
+typedef struct Span {
+	int xLeft;
+	int xRight;
+	int y;
+} Span;
+
+// Spans waiting to be scanned, allocated once by the caller and reused by every
+// Fill. It never grows, spans which do not fit are found again by a rescan.
+typedef struct SpanStack {
+	Span* pSpans;
+	int size;
+	int capacity;
+	int overflowed;
+} SpanStack;
+
+#define FILL_STACK_CAPACITY 4096
+
+// Filled cells are marked with this while filling, so a rescan can tell them
+// apart from walls, and set to 1 at the end. Cells read from in.txt are 0 or 1.
+#define FILL_MARK 0xFF
+
+typedef struct FillBounds {
+	int minX;
+	int maxX;
+	int minY;
+	int maxY;
+} FillBounds;
+
+static void PushSpan(SpanStack* pStack, const int xLeft, const int xRight, const int y)
 {
-	int curId = (pPoint->y * N) + pPoint->x;
+	if (pStack->size == pStack->capacity)
+	{
+		pStack->overflowed = 1;
+		return;
+	}
+
+	pStack->pSpans[pStack->size].xLeft = xLeft;
+	pStack->pSpans[pStack->size].xRight = xRight;
+	pStack->pSpans[pStack->size].y = y;
+	pStack->size++;
+}
+
+// Fill the empty cells of row y reachable from [xLeft, xRight], extending each
+// run of them to the walls on both sides, and push the rows next to every run
+static void FillRow(SpanStack* pStack, FillBounds* pBounds, unsigned char* pData, const int xLeft, const int xRight, const int y, const int N, const int M)
+{
+	unsigned char* pRow = pData + (size_t)y * N;
+	int x = xLeft;
+
+	while (x <= xRight)
+	{
+		int runLeft, runRight;
+
+		if (pRow[x])
+		{
+			x++;
+			continue;
+		}
+
+		runLeft = x;
+		while (runLeft > 0 && !pRow[runLeft - 1])
+		{
+			runLeft--;
+		}
+
+		runRight = x;
+		while (runRight < N - 1 && !pRow[runRight + 1])
+		{
+			runRight++;
+		}
+
+		memset(pRow + runLeft, FILL_MARK, runRight - runLeft + 1);
+
+		if (runLeft < pBounds->minX) pBounds->minX = runLeft;
+		if (runRight > pBounds->maxX) pBounds->maxX = runRight;
+		if (y < pBounds->minY) pBounds->minY = y;
+		if (y > pBounds->maxY) pBounds->maxY = y;
+
+		if (y > 0)
+		{
+			PushSpan(pStack, runLeft, runRight, y - 1);
+		}
+
+		if (y < M - 1)
+		{
+			PushSpan(pStack, runLeft, runRight, y + 1);
+		}
+
+		// The cell after the run is a wall
+		x = runRight + 2;
+	}
+}
+
+static void FillSpans(SpanStack* pStack, FillBounds* pBounds, unsigned char* pData, const int N, const int M)
+{
+	while (pStack->size)
+	{
+		Span span = pStack->pSpans[--pStack->size];
+
+		FillRow(pStack, pBounds, pData, span.xLeft, span.xRight, span.y, N, M);
+	}
+}
+
+// Fill the area of 0 cells around pPoint with 1, walking 4 neighbours, scanning
+// whole rows at a time. Uses no memory besides pStack.
+void Fill(const Point2D* pPoint, unsigned char* pData, const int N, const int M, SpanStack* pStack)
+{
+	FillBounds bounds;
 
 	if (pPoint->y < 0 || pPoint->x < 0)
 	{
@@ -39,18 +147,49 @@ void Fill(const Point2D* pPoint, unsigned char* pData, const int N, const int M)
 		return;
 	}
 
-	if (!pData[curId])
+	bounds.minX = bounds.maxX = pPoint->x;
+	bounds.minY = bounds.maxY = pPoint->y;
+
+	pStack->size = 0;
+	pStack->overflowed = 0;
+	FillRow(pStack, &bounds, pData, pPoint->x, pPoint->x, pPoint->y, N, M);
+	FillSpans(pStack, &bounds, pData, N, M);
+
+	// Spans were dropped on a full stack: find the empty cells above or below a
+	// filled one and fill from them, until a rescan drops nothing. Empty cells
+	// left or right of a filled one can't exist, runs are filled wall to wall.
+	while (pStack->overflowed)
 	{
-		pData[curId] = 1; //fill
+		pStack->overflowed = 0;
 
-		for (int i = 0; i < 4; i++)
+		for (int y = bounds.minY > 0 ? bounds.minY - 1 : 0; y <= bounds.maxY + 1 && y < M; y++)
 		{
-			Point2D neigbour;
+			const unsigned char* pRow = pData + (size_t)y * N;
+			const unsigned char* pAbove = y > 0 ? pRow - N : NULL;
+			const unsigned char* pBelow = y < M - 1 ? pRow + N : NULL;
 
-			neigbour.x = pPoint->x + neighbours[i].xDiff;
-			neigbour.y = pPoint->y + neighbours[i].yDiff;
+			for (int x = bounds.minX; x <= bounds.maxX; x++)
+			{
+				if (!pRow[x] && ((pAbove && FILL_MARK == pAbove[x]) || (pBelow && FILL_MARK == pBelow[x])))
+				{
+					FillRow(pStack, &bounds, pData, x, x, y, N, M);
+					FillSpans(pStack, &bounds, pData, N, M);
+				}
+			}
+		}
+	}
 
-			Fill(&neigbour, pData, N, M);
+	// Done, marks become the fill value
+	for (int y = bounds.minY; y <= bounds.maxY; y++)
+	{
+		unsigned char* pRow = pData + (size_t)y * N;
+
+		for (int x = bounds.minX; x <= bounds.maxX; x++)
+		{
+			if (FILL_MARK == pRow[x])
+			{
+				pRow[x] = 1;
+			}
 		}
 	}
 }
@@ -203,6 +342,7 @@ int main(int argc, char* argv[])
 {
 	unsigned char* pData;
 	Point2D mazeStart, mazeEnd, fillStart;
+	SpanStack fillStack;
 	errno_t result;
 	size_t mazeReadOffset;
 	FILE* pIn = NULL, * pOut = NULL;
@@ -276,7 +416,9 @@ int main(int argc, char* argv[])
 	}
 
 	pData = (unsigned char*)malloc(N * M * 2);
-	if (NULL != pData)
+	fillStack.pSpans = (Span*)malloc(FILL_STACK_CAPACITY * sizeof(Span));
+	fillStack.capacity = FILL_STACK_CAPACITY;
+	if (NULL != pData && NULL != fillStack.pSpans)
 	{
 		size_t nrEntries = N * M;
 		int nrObj = 2;
@@ -300,7 +442,7 @@ int main(int argc, char* argv[])
 		}
 
 		// Start fill
-		Fill(&fillStart, pData, N, M);
+		Fill(&fillStart, pData, N, M, &fillStack);
 
 		// Print fill result and reset input to original
 		fprintf(pOut, "After fill starting from %d %d:\n", fillStart.x, fillStart.y);
@@ -374,10 +516,11 @@ int main(int argc, char* argv[])
 
 			curFillVal++;
 		}
-
-		free(pData);
 	}
 
+	free(fillStack.pSpans);
+	free(pData);
+
 	fclose(pOut);
 	fclose(pIn);
 